@@ -0,0 +1,142 @@
+#include "BackupStore.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+// <name>.<utc timestamp>.<sha1 of the uncompressed contents>.sav.z
+// The timestamp first, so sorting by name sorts by age.
+static const QString s_suffix = QStringLiteral(".sav.z");
+
+static QString timestamp()
+{
+    return QDateTime::currentDateTimeUtc().toString(QStringLiteral("yyyyMMdd-hhmmsszzz"));
+}
+
+BackupStore::BackupStore(const QString &savegamePath)
+{
+    const QFileInfo info(savegamePath);
+    m_directory = info.absoluteDir().filePath(QStringLiteral("backups"));
+    m_baseName = info.completeBaseName();
+}
+
+bool BackupStore::store(const QByteArray &contents)
+{
+    const QString hash = QString::fromLatin1(QCryptographicHash::hash(contents, QCryptographicHash::Sha1).toHex());
+
+    const QString existing = findExisting(hash);
+    if (!existing.isEmpty()) {
+        const QStringList stored = generations();
+        if (!stored.isEmpty() && stored.first() == existing) {
+            // Same as the newest one, the common case when just reopening
+            return true;
+        }
+
+        // Went back to an older version, just bump it to the front instead of storing it again
+        const QString renamed = m_directory + '/' + m_baseName + '.' + timestamp() + '.' + hash + s_suffix;
+        if (QFile::rename(existing, renamed)) {
+            return true;
+        }
+        qWarning() << "Failed to rename backup" << existing << "to" << renamed;
+        return true; // still have it, just in the wrong order
+    }
+
+    if (!QDir().mkpath(m_directory)) {
+        qWarning() << "Failed to create backup directory" << m_directory;
+        return false;
+    }
+
+    QSaveFile file(m_directory + '/' + m_baseName + '.' + timestamp() + '.' + hash + s_suffix);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to open backup file" << file.fileName() << file.errorString();
+        return false;
+    }
+    const QByteArray compressed = qCompress(contents);
+    if (file.write(compressed) != compressed.size() || !file.commit()) {
+        qWarning() << "Failed to write backup" << file.fileName() << file.errorString();
+        return false;
+    }
+
+    removeOldGenerations();
+
+    return true;
+}
+
+// Splits it up again, the base name can have dots in it (and anything else)
+// so the timestamp and hash are taken from the end
+static bool parseBackupName(const QString &fileName, QString *baseName, QString *timestamp, QString *hash)
+{
+    if (!fileName.endsWith(s_suffix)) {
+        return false;
+    }
+    const QString name = fileName.left(fileName.length() - s_suffix.length());
+    const int hashStart = name.lastIndexOf('.');
+    if (hashStart <= 0) {
+        return false;
+    }
+    const int timestampStart = name.lastIndexOf('.', hashStart - 1);
+    if (timestampStart <= 0) {
+        return false;
+    }
+    *baseName = name.left(timestampStart);
+    *timestamp = name.mid(timestampStart + 1, hashStart - timestampStart - 1);
+    *hash = name.mid(hashStart + 1);
+    return true;
+}
+
+QStringList BackupStore::generations() const
+{
+    QDir dir(m_directory);
+    if (!dir.exists()) {
+        return {};
+    }
+
+    // Not with a name filter for our name, other savegames can start with
+    // the same name and the filters aren't case sensitive on all platforms
+    QStringList ret;
+    for (const QString &fileName : dir.entryList(QDir::Files, QDir::Name | QDir::Reversed)) {
+        QString baseName, fileTimestamp, hash;
+        if (!parseBackupName(fileName, &baseName, &fileTimestamp, &hash) || baseName != m_baseName) {
+            continue;
+        }
+        ret.append(dir.filePath(fileName));
+    }
+    return ret;
+}
+
+QByteArray BackupStore::restore(const QString &backupPath)
+{
+    QFile file(backupPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open backup" << backupPath << file.errorString();
+        return {};
+    }
+    return qUncompress(file.readAll());
+}
+
+QString BackupStore::findExisting(const QString &hash) const
+{
+    for (const QString &path : generations()) {
+        QString baseName, fileTimestamp, fileHash;
+        if (parseBackupName(QFileInfo(path).fileName(), &baseName, &fileTimestamp, &fileHash) && fileHash == hash) {
+            return path;
+        }
+    }
+    return {};
+}
+
+void BackupStore::removeOldGenerations()
+{
+    if (maxGenerations < 1) {
+        return;
+    }
+    const QStringList stored = generations();
+    for (int i=maxGenerations; i<stored.count(); i++) {
+        qDebug() << "Removing old backup" << stored[i];
+        QFile::remove(stored[i]);
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+// Keeps compressed copies of a savegame in a "backups" folder next to it.
+// Files are named after a hash of the contents, so opening the same savegame
+// again doesn't write anything, and only the newest few are kept.
+class BackupStore
+{
+public:
+    explicit BackupStore(const QString &savegamePath);
+
+    // Returns true if it is stored now, either by us or from before
+    bool store(const QByteArray &contents);
+
+    // Full paths, newest first
+    QStringList generations() const;
+
+    static QByteArray restore(const QString &backupPath);
+
+    QString directory() const { return m_directory; }
+
+    int maxGenerations = 10;
+
+private:
+    QString findExisting(const QString &hash) const;
+    void removeOldGenerations();
+
+    QString m_directory;
+    QString m_baseName;
+};
@@ -0,0 +1,409 @@
+#include "BatchMode.h"
+
+#include "Savegame.h"
+#include "Profile.h"
+#include "ItemData.h"
+#include "PartConstraints.h"
+#include "BuildEnumerator.h"
+#include "ItemCodec.h"
+
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QMutex>
+#include <QRegExp>
+#include <QSet>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include <cstdio>
+#include <cstring>
+
+bool BatchMode::isRequested(int argc, char *argv[])
+{
+    for (int i=1; i<argc; i++) {
+        if (strcmp(argv[i], "--batch") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int BatchMode::run(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Borderlands 3 savegame editor, headless batch mode.");
+    parser.addHelpOption();
+    parser.addOption({"batch", "Run without GUI, decode and validate the savegames given."});
+    parser.addOption({{"j", "jobs"}, "How many savegames to decode in parallel (default: number of cores).", "jobs"});
+    parser.addOption({"verbose", "Show debug output."});
+    parser.addOption({"item-database", "Use this item database (made with ItemDatabaseCompiler) instead of the built in one, reloaded if it changes.", "file"});
+    parser.addOption({"count-builds", "Count the valid part combinations for each balance instead, doesn't need any savegames."});
+    parser.addOption({"enumerate-builds", "Write the serials for every valid build of the balances of the items in the savegames instead."});
+    parser.addOption({"balance", "Only the balances matching this wildcard, with --count-builds or --enumerate-builds.", "pattern"});
+    parser.addOption({"limit", "At most this many builds per balance with --enumerate-builds.", "count"});
+    parser.addPositionalArgument("paths", "Savegames, directories or globs (e.g. 'saves/*.sav').", "paths...");
+    parser.process(arguments);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    if (!parser.isSet("verbose")) {
+        QLoggingCategory::setFilterRules("*.debug=false");
+    }
+
+    if (parser.isSet("item-database") && !ItemData::reload(parser.value("item-database"))) {
+        err << "Failed to load item database " << parser.value("item-database") << '\n';
+        return 1;
+    }
+
+    // Only need what is used for decoding, in the background while we look for files
+    QFuture<void> itemDataReady = ItemData::ready();
+
+    if (parser.isSet("jobs")) {
+        bool ok = false;
+        const int jobs = parser.value("jobs").toInt(&ok);
+        if (!ok || jobs < 1) {
+            err << "Invalid number of jobs: " << parser.value("jobs") << '\n';
+            return 2;
+        }
+        QThreadPool::globalInstance()->setMaxThreadCount(jobs);
+    } // otherwise the global pool is already sized to the number of cores
+
+    qint64 limit = -1;
+    if (parser.isSet("limit")) {
+        bool ok = false;
+        limit = parser.value("limit").toLongLong(&ok);
+        if (!ok || limit < 1) {
+            err << "Invalid limit: " << parser.value("limit") << '\n';
+            return 2;
+        }
+    }
+
+    if (parser.isSet("count-builds")) {
+        itemDataReady.waitForFinished();
+        if (!ItemData::isValid()) {
+            err << "Failed to load item databases\n";
+            return 1;
+        }
+        return countBuilds(parser.value("balance"));
+    }
+
+    const QStringList files = findSavegames(parser.positionalArguments());
+    if (files.isEmpty()) {
+        err << "No savegames found\n";
+        err.flush(); // showHelp() exits
+        parser.showHelp(2);
+    }
+
+    // Load them first, so all the threads don't sit and wait for the first one
+    itemDataReady.waitForFinished();
+    if (!ItemData::isValid()) {
+        err << "Failed to load item databases\n";
+        return 1;
+    }
+
+    if (parser.isSet("enumerate-builds")) {
+        return enumerateBuilds(files, parser.value("balance"), limit);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const QList<Result> results = QtConcurrent::blockingMapped<QList<Result>>(files, &BatchMode::process);
+
+    int failedFiles = 0;
+    int failedItems = 0;
+    int invalidParts = 0;
+    out << "file\tstatus\tcharacter\tlevel\titems\tfailed items\tinvalid parts\tload ms\terrors\n";
+    for (const Result &result : results) {
+        if (!result.loaded) {
+            failedFiles++;
+        }
+        failedItems += result.failedItems;
+        invalidParts += result.invalidParts;
+
+        out << result.filePath << '\t'
+            << (result.loaded ? "ok" : "FAILED") << '\t'
+            << result.characterName << '\t'
+            << result.level << '\t'
+            << result.itemCount << '\t'
+            << result.failedItems << '\t'
+            << result.invalidParts << '\t'
+            << result.loadTimeMs << '\t'
+            << result.errors << '\n';
+    }
+    out << "# " << files.count() << " savegames, "
+        << failedFiles << " failed to load, "
+        << failedItems << " items failed to decode, "
+        << invalidParts << " items with invalid parts, "
+        << timer.elapsed() << " ms with "
+        << QThreadPool::globalInstance()->maxThreadCount() << " threads\n";
+
+    return (failedFiles > 0 || failedItems > 0) ? 1 : 0;
+}
+
+QStringList BatchMode::findSavegames(const QStringList &paths)
+{
+    QStringList ret;
+    for (const QString &path : paths) {
+        const QFileInfo info(path);
+        if (info.isDir()) {
+            QDirIterator it(path, {"*.sav"}, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                ret.append(it.next());
+            }
+            continue;
+        }
+
+        // In case the shell didn't expand it, only supports wildcards in the filename
+        if (info.fileName().contains('*') || info.fileName().contains('?') || info.fileName().contains('[')) {
+            for (const QFileInfo &match : QDir(info.path()).entryInfoList({info.fileName()}, QDir::Files, QDir::Name)) {
+                ret.append(match.filePath());
+            }
+            continue;
+        }
+
+        if (!info.isFile()) {
+            qWarning() << "No such file:" << path;
+            continue;
+        }
+        ret.append(path);
+    }
+    ret.removeDuplicates();
+
+    return ret;
+}
+
+BatchMode::Result BatchMode::process(const QString &filePath)
+{
+    Result result;
+    result.filePath = filePath;
+
+    // Picks up changes to --item-database, but each savegame uses the same data all the way through
+    ItemData::reloadIfChanged();
+    ItemData::Pin pin;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (QFileInfo(filePath).fileName().compare("profile.sav", Qt::CaseInsensitive) == 0) {
+        Profile profile(nullptr);
+        result.loaded = profile.load(filePath);
+        result.loadTimeMs = timer.elapsed();
+        result.errors = profile.decodeReport().errorCounts();
+        if (result.loaded) {
+            result.characterName = "(profile)";
+            result.itemCount = profile.bankItems().count() + profile.lostLootItems().count();
+            result.failedItems = profile.failedItemsCount();
+            result.invalidParts = countInvalidParts(profile.bankItems()) + countInvalidParts(profile.lostLootItems());
+        }
+        return result;
+    }
+
+    Savegame savegame(nullptr);
+    result.loaded = savegame.load(filePath);
+    if (result.loaded) {
+        savegame.decodeAllItems(); // Loading only decodes what is needed to list them
+    }
+    result.loadTimeMs = timer.elapsed();
+    result.errors = savegame.decodeReport().errorCounts();
+
+    if (!result.loaded) {
+        return result;
+    }
+
+    result.characterName = savegame.characterName();
+    result.level = savegame.level();
+    result.itemCount = savegame.inventoryItemsCount();
+    result.failedItems = savegame.failedItemsCount();
+    result.invalidParts = countInvalidParts(savegame.items());
+
+    return result;
+}
+
+// The game might accept them anyways, so this doesn't count as failing
+int BatchMode::countInvalidParts(const QVector<InventoryItem> &items)
+{
+    int count = 0;
+    for (const InventoryItem &item : items) {
+        if (!item.fullyDecoded || !item.isValid()) {
+            continue; // already counted as failed
+        }
+        const PartConstraints &constraints = ItemData::partConstraints(item.objectShortName);
+        if (!constraints.check(PartConstraints::itemPartIds(item)).isEmpty()) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int BatchMode::countBuilds(const QString &balancePattern)
+{
+    QTextStream out(stdout);
+
+    // The whole name has to match, same as with --enumerate-builds
+    const QRegExp balanceFilter(balancePattern, Qt::CaseInsensitive, QRegExp::Wildcard);
+    QStringList balances;
+    for (const QString &balance : ItemData::balancesWithParts()) {
+        if (balancePattern.isEmpty() || balanceFilter.exactMatch(balance)) {
+            balances.append(balance);
+        }
+    }
+    if (balances.isEmpty()) {
+        QTextStream(stderr) << "No balances found\n";
+        return 2;
+    }
+
+    struct Count {
+        QString balance;
+        int parts = 0;
+        quint64 builds = 0;
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+
+    ItemData *snapshot = ItemData::instance();
+    const QVector<Count> counts = QtConcurrent::blockingMapped<QVector<Count>>(balances, [snapshot](const QString &balance) {
+        ItemData::Pin pin(snapshot);
+        const PartConstraints &constraints = ItemData::partConstraints(balance);
+
+        Count count;
+        count.balance = balance;
+        count.parts = constraints.partCount();
+        count.builds = BuildEnumerator(&constraints).count();
+        return count;
+    });
+
+    quint64 total = 0;
+    out << "balance\tparts\tbuilds\n";
+    for (const Count &count : counts) {
+        total += count.builds;
+        out << count.balance << '\t' << count.parts << '\t' << count.builds << '\n';
+    }
+    out << "# " << counts.count() << " balances, "
+        << total << " builds, "
+        << timer.elapsed() << " ms with "
+        << QThreadPool::globalInstance()->maxThreadCount() << " threads\n";
+
+    return 0;
+}
+
+int BatchMode::enumerateBuilds(const QStringList &files, const QString &balancePattern, const qint64 limit)
+{
+    QTextStream err(stderr);
+    const QRegExp balanceFilter(balancePattern, Qt::CaseInsensitive, QRegExp::Wildcard);
+
+    // Only the first item of each balance, the rest would just give the same builds again
+    QVector<InventoryItem> templates;
+    QSet<QString> balances;
+    for (const QString &filePath : files) {
+        for (const InventoryItem &item : loadItems(filePath)) {
+            if (!item.fullyDecoded || !item.isValid() || item.partsCategory < 0 || balances.contains(item.objectShortName)) {
+                continue;
+            }
+            if (!balancePattern.isEmpty() && !balanceFilter.exactMatch(item.objectShortName)) {
+                continue;
+            }
+            balances.insert(item.objectShortName);
+            templates.append(item);
+        }
+    }
+    if (templates.isEmpty()) {
+        err << "No items to use as templates found\n";
+        return 2;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Only one thread writes at a time, and in big chunks so they don't wait for each other
+    QMutex outputMutex;
+    const auto write = [&outputMutex](QByteArray *buffer) {
+        QMutexLocker locker(&outputMutex);
+        fwrite(buffer->constData(), 1, size_t(buffer->size()), stdout);
+        buffer->clear();
+    };
+
+    ItemData *snapshot = ItemData::instance();
+    const QVector<qint64> written = QtConcurrent::blockingMapped<QVector<qint64>>(templates, [&](const InventoryItem &templateItem) {
+        ItemData::Pin pin(snapshot);
+        const PartConstraints &constraints = ItemData::partConstraints(templateItem.objectShortName);
+
+        // Parts that aren't in the serial (like "None") are just left out
+        QVector<InventoryItem::Aspect> aspects(constraints.partCount());
+        for (int part=0; part<constraints.partCount(); part++) {
+            const StringId partId = constraints.partId(part);
+            if (ItemData::partIndex(templateItem.partsCategory, partId) > 0) {
+                aspects[part] = ItemData::createInventoryItemPart(templateItem, StringPool::string(partId));
+            }
+        }
+
+        InventoryItem item = templateItem;
+        QByteArray buffer;
+        qint64 count = 0;
+        BuildEnumerator(&constraints).forEach([&](const QVector<int> &parts) {
+            item.parts.clear();
+            for (const int part : parts) {
+                if (aspects[part].isValid()) {
+                    item.parts.append(aspects[part]);
+                }
+            }
+            if (item.parts.count() > 63) {
+                qWarning() << "Too many parts to encode for" << item.objectShortName;
+                return true;
+            }
+            item.numberOfParts = item.parts.count();
+            item.markChanged();
+
+            const std::string serial = ItemCodec::serialize(item);
+            buffer += "BL3(" + QByteArray::fromRawData(serial.data(), int(serial.size())).toBase64() + ")\n";
+            if (buffer.size() > 64 * 1024) {
+                write(&buffer);
+            }
+
+            count++;
+            return limit < 0 || count < limit;
+        });
+        write(&buffer);
+
+        return count;
+    });
+
+    qint64 total = 0;
+    for (const qint64 count : written) {
+        total += count;
+    }
+    err << "# " << total << " serials for "
+        << templates.count() << " balances, "
+        << timer.elapsed() << " ms with "
+        << QThreadPool::globalInstance()->maxThreadCount() << " threads\n";
+
+    return 0;
+}
+
+QVector<InventoryItem> BatchMode::loadItems(const QString &filePath)
+{
+    if (QFileInfo(filePath).fileName().compare("profile.sav", Qt::CaseInsensitive) == 0) {
+        Profile profile(nullptr);
+        if (!profile.load(filePath)) {
+            qWarning() << "Failed to load" << filePath;
+            return {};
+        }
+        return profile.bankItems() + profile.lostLootItems();
+    }
+
+    Savegame savegame(nullptr);
+    if (!savegame.load(filePath)) {
+        qWarning() << "Failed to load" << filePath;
+        return {};
+    }
+    savegame.decodeAllItems();
+    return savegame.items();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct InventoryItem;
+
+// Headless mode, for checking a bunch of savegames at once without the GUI.
+// Started with --batch, decodes all the files in parallel and prints a
+// summary line for each.
+class BatchMode
+{
+public:
+    struct Result {
+        QString filePath;
+        bool loaded = false;
+
+        QString characterName;
+        int level = 0;
+        int itemCount = 0;
+        int failedItems = 0;
+        int invalidParts = 0; // decoded fine, but with parts that don't go together
+        QString errors;
+
+        qint64 loadTimeMs = 0;
+    };
+
+    static bool isRequested(int argc, char *argv[]);
+    static int run(const QStringList &arguments);
+
+    // Expands directories (recursively) and globs to .sav files
+    static QStringList findSavegames(const QStringList &paths);
+
+    // profile.sav is loaded as a Profile, the items are the bank and lost loot
+    static Result process(const QString &filePath);
+
+    // --count-builds, how many valid combinations of parts each balance
+    // (matching the wildcard, if any) has
+    static int countBuilds(const QString &balancePattern);
+
+    // --enumerate-builds, writes the serials for every valid build of each
+    // balance in the savegames, with the first item of that balance as the
+    // template for everything except the parts
+    static int enumerateBuilds(const QStringList &files, const QString &balancePattern, const qint64 limit);
+
+private:
+    static int countInvalidParts(const QVector<InventoryItem> &items);
+    static QVector<InventoryItem> loadItems(const QString &filePath);
+};
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <QByteArray>
+#include <QVector>
+#include <QtEndian>
+#include <QDebug>
+
+#include <cstdint>
+#include <cstring>
+
+// Reads and writes LSB-first bit fields, like the game does.
+// Bits are kept packed in little endian 64 bit words, reading just moves a
+// cursor and writing appends at the end, so nothing gets copied around.
+struct BitParser
+{
+    BitParser() = default;
+
+    BitParser(const QByteArray &data) :
+        m_size(data.size() * 8)
+    {
+        if (data.isEmpty()) {
+            return;
+        }
+        m_words.resize((data.size() + 7) / 8);
+        memcpy(m_words.data(), data.constData(), size_t(data.size()));
+        for (uint64_t &word : m_words) {
+            word = qFromLittleEndian(word);
+        }
+    }
+
+    int bitsLeft() const {
+        return m_size - m_pos;
+    }
+
+    // Returns -1 if there isn't enough bits left
+    int eat(const int count) {
+        if (count <= 0) {
+            return 0;
+        }
+        if (count > 32) {
+            qWarning() << "Trying to read too many bits at once" << count;
+            return -1;
+        }
+        if (count > bitsLeft()) {
+            qWarning() << "Invalid amount of bits requested" << count << "only have" << bitsLeft();
+            return -1;
+        }
+        return int(read(count));
+    }
+
+    void put(const uint64_t number, const int count) {
+        if (count < 0 || count >= int(sizeof(number) * 8)) {
+            qWarning() << "Trying to store invalid amount of bits" << count;
+            return;
+        }
+        write(number, count);
+    }
+
+    // Appends the first count bits of data, as returned from remaining()
+    void putBits(const QByteArray &data, const int count) {
+        if (count > data.size() * 8) {
+            qWarning() << "Trying to store" << count << "bits from" << data.size() << "bytes";
+            return;
+        }
+        BitParser source(data);
+        int left = count;
+        while (left > 0) {
+            const int chunk = qMin(left, 64);
+            write(source.read(chunk), chunk);
+            left -= chunk;
+        }
+    }
+
+    // Packs whatever hasn't been eaten yet, without consuming it
+    QByteArray remaining() const {
+        BitParser copy(*this);
+        BitParser ret;
+        while (copy.bitsLeft() > 0) {
+            const int chunk = qMin(copy.bitsLeft(), 64);
+            ret.write(copy.read(chunk), chunk);
+        }
+        return ret.toBinaryData();
+    }
+
+    bool remainingIsZero() const {
+        BitParser copy(*this);
+        while (copy.bitsLeft() > 0) {
+            if (copy.read(qMin(copy.bitsLeft(), 64)) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    QByteArray toBinaryData() const {
+        QByteArray ret(m_words.count() * int(sizeof(uint64_t)), Qt::Uninitialized);
+        for (int i=0; i<m_words.count(); i++) {
+            qToLittleEndian(m_words[i], ret.data() + i * sizeof(uint64_t));
+        }
+        ret.truncate((m_size + 7) / 8);
+        return ret;
+    }
+
+private:
+    // No bounds checks, count needs to be between 1 and 64
+    uint64_t read(const int count) {
+        const int word = m_pos / 64;
+        const int shift = m_pos % 64;
+
+        uint64_t value = m_words[word] >> shift;
+        if (shift + count > 64) {
+            value |= m_words[word + 1] << (64 - shift);
+        }
+        if (count < 64) {
+            value &= (uint64_t(1) << count) - 1;
+        }
+
+        m_pos += count;
+        return value;
+    }
+
+    void write(uint64_t value, const int count) {
+        if (count <= 0) {
+            return;
+        }
+        if (count < 64) {
+            value &= (uint64_t(1) << count) - 1;
+        }
+        const int word = m_size / 64;
+        const int shift = m_size % 64;
+        m_words.resize((m_size + count + 63) / 64); // new words are zeroed
+
+        m_words[word] |= value << shift;
+        if (shift + count > 64) {
+            m_words[word + 1] |= value >> (64 - shift);
+        }
+        m_size += count;
+    }
+
+    QVector<uint64_t> m_words;
+    int m_pos = 0;
+    int m_size = 0;
+};
@@ -0,0 +1,190 @@
+#include "BuildEnumerator.h"
+
+BuildEnumerator::BuildEnumerator(const PartConstraints *constraints) :
+    m_constraints(constraints)
+{
+    const int partCount = constraints->partCount();
+    const int categoryCount = constraints->categoryCount();
+
+    m_categoryParts.resize(categoryCount);
+    m_conflicts.fill(PartSet(partCount), partCount);
+    m_lastDependencyCategory.fill(-1, partCount);
+    QVector<int> lastLinkedCategory(partCount, -1);
+
+    for (int part=0; part<partCount; part++) {
+        const int category = constraints->partCategory(part);
+        if (category >= 0) {
+            m_categoryParts[category].append(part);
+        }
+
+        m_conflicts[part] |= constraints->excluders(part);
+        constraints->excluders(part).forEach([this, part](const int excluder) {
+            m_conflicts[excluder].set(part);
+        });
+
+        constraints->dependencies(part).forEach([&](const int dependency) {
+            const int dependencyCategory = constraints->partCategory(dependency);
+            m_lastDependencyCategory[part] = qMax(m_lastDependencyCategory[part], dependencyCategory);
+            lastLinkedCategory[part] = qMax(lastLinkedCategory[part], dependencyCategory);
+            lastLinkedCategory[dependency] = qMax(lastLinkedCategory[dependency], category);
+        });
+    }
+
+    // After the excluders are filled in both ways
+    for (int part=0; part<partCount; part++) {
+        m_conflicts[part].forEach([&](const int other) {
+            lastLinkedCategory[part] = qMax(lastLinkedCategory[part], constraints->partCategory(other));
+        });
+    }
+
+    // A part matters from the category after its own, until the last one
+    // that has something it is linked to
+    m_relevant.fill(PartSet(partCount), categoryCount + 1);
+    for (int part=0; part<partCount; part++) {
+        const int category = constraints->partCategory(part);
+        if (category < 0) {
+            continue;
+        }
+        for (int later=category + 1; later<=lastLinkedCategory[part]; later++) {
+            m_relevant[later].set(part);
+        }
+    }
+}
+
+quint64 BuildEnumerator::count()
+{
+    if (m_constraints->isEmpty()) {
+        return 0;
+    }
+    const PartSet none(m_constraints->partCount());
+    return countFrom(0, none, none);
+}
+
+void BuildEnumerator::forEach(const std::function<bool (const QVector<int> &)> &func)
+{
+    if (m_constraints->isEmpty()) {
+        return;
+    }
+    const PartSet none(m_constraints->partCount());
+    if (countFrom(0, none, none) == 0) {
+        return;
+    }
+    walk(0, none, none, func);
+}
+
+quint64 BuildEnumerator::countFrom(const int category, const PartSet &chosen, const PartSet &unmet)
+{
+    if (category == m_categoryParts.count()) {
+        return 1; // finishCategory() doesn't let anything through with unmet dependencies at the end
+    }
+
+    const State state = { category, chosen & m_relevant[category], unmet };
+    QHash<State, quint64>::const_iterator it = m_counts.constFind(state);
+    if (it != m_counts.constEnd()) {
+        return *it;
+    }
+
+    quint64 count = 0;
+    forEachChoice(category, chosen, unmet, [&](const PartSet &nextChosen, const PartSet &nextUnmet) {
+        count += countFrom(category + 1, nextChosen, nextUnmet);
+        return true;
+    });
+    m_counts.insert(state, count);
+    return count;
+}
+
+bool BuildEnumerator::walk(const int category, const PartSet &chosen, const PartSet &unmet, const std::function<bool (const QVector<int> &)> &func)
+{
+    if (category == m_categoryParts.count()) {
+        QVector<int> parts;
+        for (const QVector<int> &categoryParts : m_categoryParts) {
+            for (const int part : categoryParts) {
+                if (chosen.test(part)) {
+                    parts.append(part);
+                }
+            }
+        }
+        return func(parts);
+    }
+
+    bool keepGoing = true;
+    forEachChoice(category, chosen, unmet, [&](const PartSet &nextChosen, const PartSet &nextUnmet) {
+        if (countFrom(category + 1, nextChosen, nextUnmet) == 0) {
+            return true; // dead end, don't bother
+        }
+        keepGoing = walk(category + 1, nextChosen, nextUnmet, func);
+        return keepGoing;
+    });
+    return keepGoing;
+}
+
+void BuildEnumerator::forEachChoice(const int category, const PartSet &chosen, const PartSet &unmet, const std::function<bool (const PartSet &, const PartSet &)> &next)
+{
+    pick(category, 0, 0, chosen, unmet, next);
+}
+
+bool BuildEnumerator::pick(const int category, const int first, const int picked, const PartSet &chosen, const PartSet &unmet, const std::function<bool (const PartSet &, const PartSet &)> &next)
+{
+    const PartConstraints::Category &bounds = m_constraints->category(category);
+    if (m_constraints->isValidCount(category, picked)) {
+        if (!finishCategory(category, chosen, unmet, next)) {
+            return false;
+        }
+    }
+    if (picked >= bounds.maxParts) {
+        return true;
+    }
+
+    const QVector<int> &parts = m_categoryParts[category];
+    for (int i=first; i<parts.count(); i++) {
+        if (picked + parts.count() - i < bounds.minParts) {
+            break; // not enough left
+        }
+
+        const int part = parts[i];
+        if (m_conflicts[part].intersects(chosen)) {
+            continue;
+        }
+
+        // If the dependencies were all in earlier categories we already know
+        const PartSet &dependencies = m_constraints->dependencies(part);
+        if (!dependencies.isEmpty() && m_lastDependencyCategory[part] < category && !dependencies.intersects(chosen)) {
+            continue;
+        }
+
+        PartSet withPart(chosen);
+        withPart.set(part);
+        if (!pick(category, i + 1, picked + 1, withPart, unmet, next)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BuildEnumerator::finishCategory(const int category, const PartSet &chosen, const PartSet &unmet, const std::function<bool (const PartSet &, const PartSet &)> &next)
+{
+    PartSet stillUnmet(m_constraints->partCount());
+    bool dead = false;
+    const auto checkDependencies = [&](const int part) {
+        const PartSet &dependencies = m_constraints->dependencies(part);
+        if (dependencies.isEmpty() || dependencies.intersects(chosen)) {
+            return;
+        }
+        if (m_lastDependencyCategory[part] > category) {
+            stillUnmet.set(part);
+        } else {
+            dead = true;
+        }
+    };
+
+    unmet.forEach(checkDependencies);
+    for (const int part : m_categoryParts[category]) {
+        if (chosen.test(part)) {
+            checkDependencies(part);
+        }
+    }
+    if (dead) {
+        return true; // try the next one
+    }
+    return next(chosen, stillUnmet);
+}
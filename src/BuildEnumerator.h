@@ -0,0 +1,69 @@
+#pragma once
+
+#include "PartConstraints.h"
+
+#include <QHash>
+#include <QVector>
+
+#include <functional>
+
+// Walks every valid combination of parts for a balance, with the constraints
+// from PartConstraints. A build is valid by the same rules as
+// PartConstraints::check(): no parts or between min and max parts from each
+// category, all the dependencies and none of the excluders.
+//
+// The categories are filled one at a time, and after each one only the
+// parts that are linked to a later category matter. So how many builds
+// there are from that point on is remembered for each of those, which makes
+// counting them fast even when there are billions, and means forEach()
+// never goes down a branch that doesn't end in a valid build.
+//
+// Not thread safe, use one per thread.
+class BuildEnumerator
+{
+public:
+    explicit BuildEnumerator(const PartConstraints *constraints);
+
+    quint64 count();
+
+    // Part indexes in the PartConstraints, in category order. Stops if func
+    // returns false.
+    void forEach(const std::function<bool(const QVector<int> &parts)> &func);
+
+private:
+    struct State {
+        int category;
+        PartSet chosen; // only the ones that matter for the categories after this
+        PartSet unmet; // chosen, but the dependency has to come from a later category
+
+        bool operator==(const State &other) const {
+            return category == other.category && chosen == other.chosen && unmet == other.unmet;
+        }
+    };
+    friend uint qHash(const State &state, const uint seed) {
+        return qHash(state.chosen, seed) ^ qHash(state.unmet, seed) ^ uint(state.category);
+    }
+
+    quint64 countFrom(const int category, const PartSet &chosen, const PartSet &unmet);
+
+    // Calls next(chosen, unmet) for each way to fill the category
+    void forEachChoice(const int category, const PartSet &chosen, const PartSet &unmet,
+                       const std::function<bool(const PartSet &chosen, const PartSet &unmet)> &next);
+    bool pick(const int category, const int first, const int picked, const PartSet &chosen, const PartSet &unmet,
+              const std::function<bool(const PartSet &chosen, const PartSet &unmet)> &next);
+    bool finishCategory(const int category, const PartSet &chosen, const PartSet &unmet,
+                        const std::function<bool(const PartSet &chosen, const PartSet &unmet)> &next);
+
+    bool walk(const int category, const PartSet &chosen, const PartSet &unmet,
+              const std::function<bool(const QVector<int> &parts)> &func);
+
+    const PartConstraints *m_constraints;
+
+    QVector<QVector<int>> m_categoryParts;
+    QVector<PartSet> m_conflicts; // excluders both ways
+    QVector<int> m_lastDependencyCategory; // -1 if it has none, or none that can be chosen
+    QVector<PartSet> m_relevant; // chosen parts that still matter when starting on a category
+    QVector<int> m_chosenParts; // for forEach()
+
+    QHash<State, quint64> m_counts;
+};
@@ -1,14 +1,125 @@
 #include "Constants.h"
 
-#include <unordered_map>
-#include <string>
+#include <QDebug>
 
-const std::unordered_map<Constants::Currency, int> Constants::currencyHashes = {
-    { Constants::Currency::Money, 618814354 },
-    { Constants::Currency::Eridium, 3679636065 },
+#include <algorithm>
+#include <string_view>
+
+namespace {
+
+// The tables here are laid out and checked by the compiler, so looking
+// things up doesn't allocate anything and nothing is built when starting.
+//
+// Each one is listed in the same order as the enum, so going from the enum to
+// the key is indexing the array. Going the other way is a perfect hash (with
+// a seed the compiler finds) into the same array.
+
+constexpr uint32_t fnv1a(const std::string_view key, const uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (const char c : key) {
+        hash ^= uint8_t(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+constexpr uint32_t fnv1a(const uint32_t key, const uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (int byte=0; byte<4; byte++) {
+        hash ^= (key >> (byte * 8)) & 0xFF;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// The low bits of FNV only depend on the low bits of the seed, so mix it
+// before we use it for picking a slot
+template<typename KEY>
+constexpr uint32_t slotHash(const KEY &key, const uint32_t seed)
+{
+    uint32_t hash = fnv1a(key, seed);
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+template<typename KEY, typename VALUE, size_t COUNT>
+class LookupTable
+{
+public:
+    struct Entry {
+        KEY key;
+        VALUE value;
+    };
+
+    constexpr LookupTable(const std::array<Entry, COUNT> &entries) :
+        m_entries(entries)
+    {
+        while (m_seed < maxSeed && !tryFill()) {
+            m_seed++;
+        }
+    }
+
+    // For static_assert
+    constexpr bool isValid() const {
+        if (m_seed >= maxSeed) {
+            return false;
+        }
+        for (size_t i=0; i<COUNT; i++) {
+            if (int(m_entries[i].value) != int(m_entries[0].value) + int(i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    VALUE value(const KEY &key, const VALUE invalid) const {
+        const int index = m_slots[slotHash(key, m_seed) % slotCount];
+        if (index < 0 || m_entries[index].key != key) {
+            return invalid;
+        }
+        return m_entries[index].value;
+    }
+
+    KEY key(const VALUE value, const KEY invalid) const {
+        const int index = int(value) - int(m_entries[0].value);
+        if (index < 0 || index >= int(COUNT)) {
+            return invalid;
+        }
+        return m_entries[index].key;
+    }
+
+private:
+    static constexpr size_t slotCount = COUNT * 2; // some slack so it finds a seed quickly
+    static constexpr uint32_t maxSeed = 10000;
+
+    constexpr bool tryFill() {
+        for (size_t slot=0; slot<slotCount; slot++) {
+            m_slots[slot] = -1;
+        }
+        for (size_t i=0; i<COUNT; i++) {
+            const size_t slot = slotHash(m_entries[i].key, m_seed) % slotCount;
+            if (m_slots[slot] != -1) {
+                return false;
+            }
+            m_slots[slot] = int8_t(i);
+        }
+        return true;
+    }
+
+    std::array<Entry, COUNT> m_entries{};
+    std::array<int8_t, slotCount> m_slots{};
+    uint32_t m_seed = 0;
 };
 
-const QList<int> Constants::requiredXp = {
+} // namespace
+
+static constexpr std::array<int, 80> xpForLevel = {{
     0,          // lvl 1
     358,        // lvl 2
     1241,       // lvl 3
@@ -89,55 +200,51 @@ const QList<int> Constants::requiredXp = {
     11912801,    // lvl 78
     12345393,    // lvl 79
     12787955,    // lvl 80
-};
+}};
 
-template<typename T, typename V>
-static std::unordered_map<T, V> reverseMapping(const std::unordered_map<V, T> &mapping)
+static constexpr bool isIncreasing(const std::array<int, 80> &values)
 {
-    std::unordered_map<T, V> ret;
-    for (const std::pair<const V, T> &entry : mapping) {
-        ret[entry.second] = entry.first;
+    for (size_t i=1; i<values.size(); i++) {
+        if (values[i] <= values[i-1]) {
+            return false;
+        }
     }
-
-    return ret;
+    return true;
 }
+static_assert(isIncreasing(xpForLevel), "levelFromXp() does a binary search");
+
+const std::array<int, 80> Constants::requiredXp = xpForLevel;
 
-// Don't need to account for invalid enums
-template<typename T>
-static std::string lookupString(const T val, const std::unordered_map<T, std::string> &map)
+int Constants::levelFromXp(const int xp)
 {
-    typename std::unordered_map<T, std::string>::const_iterator it = map.find(val);
-    if (it == map.end()) {
-        return "";
+    // The number of levels we have enough xp for
+    const std::array<int, 80>::const_iterator next = std::upper_bound(requiredXp.begin(), requiredXp.end(), xp);
+    if (next == requiredXp.end()) {
+        qWarning() << "Invalid amount of xp" << xp << ", can't get level";
     }
-    return it->second;
+    return int(next - requiredXp.begin());
 }
 
-
-
 ////////////////////////////////////
 // Character classes
 ////////////////////////////////////
 
-const std::unordered_map<std::string, Constants::Class> Constants::classObjectNames = {
-    { "Game/PlayerCharacters/Beastmaster/PlayerClassId_Beastmaster.PlayerClassId_Beastmaster", Class::Beastmaster} ,
-    { "Game/PlayerCharacters/Gunner/PlayerClassId_Gunner.PlayerClassId_Gunner", Class::Gunner} ,
-    { "Game/PlayerCharacters/Operative/PlayerClassId_Operative.PlayerClassId_Operative", Class::Operative} ,
-    { "Game/PlayerCharacters/SirenBrawler/PlayerClassId_Siren.PlayerClassId_Siren", Class::Siren} ,
-};
+static constexpr LookupTable<std::string_view, Constants::Class, 4> classObjectNames({{
+    { "Game/PlayerCharacters/Beastmaster/PlayerClassId_Beastmaster.PlayerClassId_Beastmaster", Constants::Class::Beastmaster },
+    { "Game/PlayerCharacters/Gunner/PlayerClassId_Gunner.PlayerClassId_Gunner", Constants::Class::Gunner },
+    { "Game/PlayerCharacters/Operative/PlayerClassId_Operative.PlayerClassId_Operative", Constants::Class::Operative },
+    { "Game/PlayerCharacters/SirenBrawler/PlayerClassId_Siren.PlayerClassId_Siren", Constants::Class::Siren },
+}});
+static_assert(classObjectNames.isValid(), "Invalid class table");
 
 Constants::Class Constants::classFromObjectName(const std::string &key)
 {
-    std::unordered_map<std::string, Class>::const_iterator it = classObjectNames.find(key);
-    if (it == classObjectNames.end()) {
-        return Class::Invalid;
-    }
-    return it->second;
+    return classObjectNames.value(key, Class::Invalid);
 }
 
 std::string Constants::objectNameFromClass(const Constants::Class characterClass)
 {
-    return lookupString(characterClass, reverseMapping(classObjectNames));
+    return std::string(classObjectNames.key(characterClass, {}));
 }
 
 
@@ -145,72 +252,66 @@ std::string Constants::objectNameFromClass(const Constants::Class characterClass
 // Pets
 ////////////////////////////////////
 
-const std::unordered_map<std::string, Constants::Pet> Constants::petKeys = {
-        { "petmonkey", Pet::Jabber },
-        { "petspiderant", Pet::Spiderant },
-        { "petskag", Pet::Skag },
-};
+static constexpr LookupTable<std::string_view, Constants::Pet, 3> petKeys({{
+    { "petmonkey", Constants::Pet::Jabber },
+    { "petspiderant", Constants::Pet::Spiderant },
+    { "petskag", Constants::Pet::Skag },
+}});
+static_assert(petKeys.isValid(), "Invalid pet table");
 
 Constants::Pet Constants::petFromKey(const std::string &key)
 {
-    std::unordered_map<std::string, Pet>::const_iterator it = petKeys.find(key);
-    if (it == petKeys.end()) {
-        return Pet::Invalid;
-    }
-    return it->second;
+    return petKeys.value(key, Pet::Invalid);
 }
 
 std::string Constants::keyFromPet(const Pet pet)
 {
-    return lookupString(pet, reverseMapping(petKeys));
+    return std::string(petKeys.key(pet, {}));
 }
 
 ////////////////////////////////////
 // Inventory slots
 ////////////////////////////////////
 
-const std::unordered_map<std::string, Constants::Slot> Constants::slotNames = {
-        {"/Game/Gear/Weapons/_Shared/_Design/InventorySlots/BPInvSlot_Weapon1.BPInvSlot_Weapon1", Slot::Weapon1 },
-        {"/Game/Gear/Weapons/_Shared/_Design/InventorySlots/BPInvSlot_Weapon2.BPInvSlot_Weapon2", Slot::Weapon2 },
-        { "/Game/Gear/Weapons/_Shared/_Design/InventorySlots/BPInvSlot_Weapon3.BPInvSlot_Weapon3", Slot::Weapon3},
-        { "/Game/Gear/Weapons/_Shared/_Design/InventorySlots/BPInvSlot_Weapon4.BPInvSlot_Weapon4", Slot::Weapon4},
-        { "/Game/Gear/Shields/_Design/A_Data/BPInvSlot_Shield.BPInvSlot_Shield", Slot::Shield},
-        { "/Game/Gear/GrenadeMods/_Design/A_Data/BPInvSlot_GrenadeMod.BPInvSlot_GrenadeMod", Slot::Grenade},
-        { "/Game/Gear/ClassMods/_Design/_Data/BPInvSlot_ClassMod.BPInvSlot_ClassMod", Slot::COM},
-        { "/Game/Gear/Artifacts/_Design/_Data/BPInvSlot_Artifact.BPInvSlot_Artifact", Slot::Artifact},
-    };
+static constexpr LookupTable<std::string_view, Constants::Slot, 8> slotNames({{
+    { "/Game/Gear/Weapons/_Shared/_Design/InventorySlots/BPInvSlot_Weapon1.BPInvSlot_Weapon1", Constants::Slot::Weapon1 },
+    { "/Game/Gear/Weapons/_Shared/_Design/InventorySlots/BPInvSlot_Weapon2.BPInvSlot_Weapon2", Constants::Slot::Weapon2 },
+    { "/Game/Gear/Weapons/_Shared/_Design/InventorySlots/BPInvSlot_Weapon3.BPInvSlot_Weapon3", Constants::Slot::Weapon3 },
+    { "/Game/Gear/Weapons/_Shared/_Design/InventorySlots/BPInvSlot_Weapon4.BPInvSlot_Weapon4", Constants::Slot::Weapon4 },
+    { "/Game/Gear/Shields/_Design/A_Data/BPInvSlot_Shield.BPInvSlot_Shield", Constants::Slot::Shield },
+    { "/Game/Gear/GrenadeMods/_Design/A_Data/BPInvSlot_GrenadeMod.BPInvSlot_GrenadeMod", Constants::Slot::Grenade },
+    { "/Game/Gear/ClassMods/_Design/_Data/BPInvSlot_ClassMod.BPInvSlot_ClassMod", Constants::Slot::COM },
+    { "/Game/Gear/Artifacts/_Design/_Data/BPInvSlot_Artifact.BPInvSlot_Artifact", Constants::Slot::Artifact },
+}});
+static_assert(slotNames.isValid(), "Invalid slot table");
 
 Constants::Slot Constants::slotFromObjectName(const std::string &objectName)
 {
-    std::unordered_map<std::string, Slot>::const_iterator it = slotNames.find(objectName);
-    if (it == slotNames.end()) {
-        return Slot::Invalid;
-    }
-    return it->second;
+    return slotNames.value(objectName, Slot::Invalid);
 }
 
 std::string Constants::objectNameFromSlot(const Constants::Slot slot)
 {
-    return lookupString(slot, reverseMapping(slotNames));
+    return std::string(slotNames.key(slot, {}));
 }
 
+////////////////////////////////////
+// Currencies
+////////////////////////////////////
+
+static constexpr LookupTable<uint32_t, Constants::Currency, 2> currencyHashes({{
+    { 618814354u, Constants::Currency::Money },
+    { 3679636065u, Constants::Currency::Eridium },
+}});
+static_assert(currencyHashes.isValid(), "Invalid currency table");
+
+// The hashes are unsigned, but the protobuf has them as int
 Constants::Currency Constants::currencyByHash(const int hash)
 {
-    static const std::unordered_map<int, Currency> reverse = reverseMapping(currencyHashes);
-    std::unordered_map<int, Currency>::const_iterator it = reverse.find(hash);
-    if (it == reverse.end()) {
-        return Currency::Invalid;
-    }
-
-    return it->second;
+    return currencyHashes.value(uint32_t(hash), Currency::Invalid);
 }
 
 int Constants::hashByCurrency(const Constants::Currency currency)
 {
-    std::unordered_map<Currency, int>::const_iterator it = currencyHashes.find(currency);
-    if (it == currencyHashes.end()) {
-        return -1;
-    }
-    return it->second;
-
+    return int(currencyHashes.key(currency, uint32_t(-1)));
 }
@@ -6,6 +6,9 @@
 #include <QString>
 #include <QMetaEnum>
 
+#include <array>
+#include <string>
+
 struct Constants : public QObject
 {
     Q_OBJECT
@@ -25,7 +28,6 @@ public:
         Siren
     };
     Q_ENUM(Class)
-    static const std::unordered_map<std::string, Class> classObjectNames;
     static Class classFromObjectName(const std::string &key);
     static std::string objectNameFromClass(const Class characterClass);
 
@@ -36,7 +38,6 @@ public:
         Skag
     };
     Q_ENUM(Pet)
-    static const std::unordered_map<std::string, Pet> petKeys;
     static Pet petFromKey(const std::string &key);
     static std::string keyFromPet(const Pet pet);
 
@@ -52,8 +53,6 @@ public:
         Artifact
     };
     Q_ENUM(Slot)
-    static const std::unordered_map<std::string, Slot> slotNames;
-
     static Slot slotFromObjectName(const std::string &objectName);
     static std::string objectNameFromSlot(const Slot slot);
 
@@ -63,13 +62,15 @@ public:
         Eridium
     };
     Q_ENUM(Currency)
-    static const std::unordered_map<Currency, int> currencyHashes;
     static Currency currencyByHash(const int hash);
     static int hashByCurrency(const Currency currency);
 
     static constexpr int minLevel = 1;
     static constexpr int maxLevel = 57;
-    static const QList<int> requiredXp;
+    static const std::array<int, 80> requiredXp; // index is level - 1
+
+    // Binary search in requiredXp
+    static int levelFromXp(const int xp);
 };
 
 #endif // CONSTANTS_H
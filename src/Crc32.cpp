@@ -0,0 +1,100 @@
+#include "Crc32.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__aarch64__) && defined(__linux__) && defined(__GNUC__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define HAVE_ARM_CRC32_DISPATCH
+#endif
+
+namespace {
+
+// Slice-by-8, table[0] is the normal byte-at-a-time table, and table[n] is
+// the crc of a byte followed by n zero bytes.
+struct Tables {
+    std::array<std::array<uint32_t, 256>, 8> table{};
+
+    constexpr Tables() {
+        for (uint32_t i=0; i<256; i++) {
+            uint32_t val = i;
+            for (int bit=0; bit<8; bit++) {
+                val = (val & 1) ? (val >> 1) ^ 0xEDB88320 : val >> 1;
+            }
+            table[0][i] = val;
+        }
+        for (uint32_t i=0; i<256; i++) {
+            for (int slice=1; slice<8; slice++) {
+                const uint32_t prev = table[slice - 1][i];
+                table[slice][i] = (prev >> 8) ^ table[0][prev & 0xFF];
+            }
+        }
+    }
+};
+constexpr Tables s_tables;
+
+uint32_t updateSliceBy8(uint32_t crc, const uint8_t *data, size_t size)
+{
+    const auto &t = s_tables.table;
+
+    while (size >= 8) {
+        uint32_t low, high;
+        memcpy(&low, data, sizeof(low));
+        memcpy(&high, data + 4, sizeof(high));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        low = __builtin_bswap32(low);
+        high = __builtin_bswap32(high);
+#endif
+        low ^= crc;
+        crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+              t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+        data += 8;
+        size -= 8;
+    }
+
+    while (size--) {
+        crc = t[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef HAVE_ARM_CRC32_DISPATCH
+// ARMv8 has instructions for the normal crc32 polynomial (x86 only has crc32c, so no luck there)
+__attribute__((target("+crc")))
+uint32_t updateArm(uint32_t crc, const uint8_t *data, size_t size)
+{
+    while (size >= 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc = __crc32d(crc, word);
+        data += 8;
+        size -= 8;
+    }
+    while (size--) {
+        crc = __crc32b(crc, *data++);
+    }
+    return crc;
+}
+#endif
+
+using UpdateFunction = uint32_t(*)(uint32_t, const uint8_t*, size_t);
+
+UpdateFunction pickImplementation()
+{
+#ifdef HAVE_ARM_CRC32_DISPATCH
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32) {
+        return updateArm;
+    }
+#endif
+    return updateSliceBy8;
+}
+
+} // namespace
+
+void Crc32::update(const void *data, const size_t size)
+{
+    static const UpdateFunction implementation = pickImplementation();
+    m_state = implementation(m_state, static_cast<const uint8_t*>(data), size);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Normal zlib-style crc32, can be fed piece by piece so we don't have to
+// glue together buffers just to checksum them.
+class Crc32
+{
+public:
+    void update(const void *data, const size_t size);
+    uint32_t value() const { return ~m_state; }
+
+    static uint32_t checksum(const void *data, const size_t size) {
+        Crc32 crc;
+        crc.update(data, size);
+        return crc.value();
+    }
+
+private:
+    uint32_t m_state = 0xFFFFFFFF;
+};
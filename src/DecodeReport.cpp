@@ -0,0 +1,101 @@
+#include "DecodeReport.h"
+
+#include <QMap>
+#include <QStringList>
+
+void DecodeReport::add(const DecodeError error, const QString &message, const int itemIndex)
+{
+    Diagnostic diagnostic;
+    diagnostic.error = error;
+    diagnostic.itemIndex = itemIndex;
+    diagnostic.message = message;
+    m_diagnostics.append(diagnostic);
+}
+
+void DecodeReport::add(const Diagnostic &diagnostic)
+{
+    if (diagnostic.error == DecodeError::None) {
+        return;
+    }
+    m_diagnostics.append(diagnostic);
+}
+
+int DecodeReport::failedItemsCount() const
+{
+    int count = 0;
+    for (const Diagnostic &diagnostic : m_diagnostics) {
+        if (diagnostic.itemIndex >= 0 && diagnostic.isError()) {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool DecodeReport::hasErrors() const
+{
+    for (const Diagnostic &diagnostic : m_diagnostics) {
+        if (diagnostic.isError()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString DecodeReport::toText() const
+{
+    QStringList lines;
+    for (const Diagnostic &diagnostic : m_diagnostics) {
+        if (diagnostic.itemIndex >= 0) {
+            lines.append(QStringLiteral("Item %1: %2").arg(diagnostic.itemIndex).arg(diagnostic.message));
+        } else {
+            lines.append(diagnostic.message);
+        }
+    }
+    return lines.join('\n');
+}
+
+QString DecodeReport::errorCounts(const bool includeWarnings) const
+{
+    QMap<DecodeError, int> counts;
+    for (const Diagnostic &diagnostic : m_diagnostics) {
+        if (!includeWarnings && !diagnostic.isError()) {
+            continue;
+        }
+        counts[diagnostic.error]++;
+    }
+
+    QStringList ret;
+    for (QMap<DecodeError, int>::const_iterator it = counts.constBegin(); it != counts.constEnd(); it++) {
+        ret.append(QStringLiteral("%1 x%2").arg(errorName(it.key())).arg(it.value()));
+    }
+    return ret.join(", ");
+}
+
+QString DecodeReport::errorName(const DecodeError error)
+{
+    switch(error) {
+    case DecodeError::None: return QStringLiteral("None");
+    case DecodeError::FileOpenFailed: return QStringLiteral("FileOpenFailed");
+    case DecodeError::InvalidMagic: return QStringLiteral("InvalidMagic");
+    case DecodeError::TruncatedHeader: return QStringLiteral("TruncatedHeader");
+    case DecodeError::TooManyCustomFormats: return QStringLiteral("TooManyCustomFormats");
+    case DecodeError::InvalidCustomFormat: return QStringLiteral("InvalidCustomFormat");
+    case DecodeError::WrongDataLength: return QStringLiteral("WrongDataLength");
+    case DecodeError::ProtobufParseFailed: return QStringLiteral("ProtobufParseFailed");
+    case DecodeError::ProtobufNotInitialized: return QStringLiteral("ProtobufNotInitialized");
+    case DecodeError::SerialTooShort: return QStringLiteral("SerialTooShort");
+    case DecodeError::InvalidSerialStart: return QStringLiteral("InvalidSerialStart");
+    case DecodeError::ChecksumMismatch: return QStringLiteral("ChecksumMismatch");
+    case DecodeError::InvalidItemStart: return QStringLiteral("InvalidItemStart");
+    case DecodeError::UnsupportedVersion: return QStringLiteral("UnsupportedVersion");
+    case DecodeError::InvalidBalance: return QStringLiteral("InvalidBalance");
+    case DecodeError::InvalidData: return QStringLiteral("InvalidData");
+    case DecodeError::InvalidManufacturer: return QStringLiteral("InvalidManufacturer");
+    case DecodeError::UnknownPartCategory: return QStringLiteral("UnknownPartCategory");
+    case DecodeError::InvalidPart: return QStringLiteral("InvalidPart");
+    case DecodeError::InvalidGenericPart: return QStringLiteral("InvalidGenericPart");
+    case DecodeError::InvalidItem: return QStringLiteral("InvalidItem");
+    case DecodeError::ReEncodingFailed: return QStringLiteral("ReEncodingFailed");
+    }
+    return QStringLiteral("Unknown");
+}
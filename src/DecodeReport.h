@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+enum class DecodeError {
+    None,
+
+    // Whole file
+    FileOpenFailed,
+    InvalidMagic,
+    TruncatedHeader,
+    TooManyCustomFormats,
+    InvalidCustomFormat,
+    WrongDataLength,
+    ProtobufParseFailed,
+    ProtobufNotInitialized,
+
+    // Item serials
+    SerialTooShort,
+    InvalidSerialStart,
+    ChecksumMismatch,
+    InvalidItemStart,
+    UnsupportedVersion,
+    InvalidBalance,
+    InvalidData,
+    InvalidManufacturer,
+    UnknownPartCategory,
+    InvalidPart,
+    InvalidGenericPart,
+    InvalidItem,
+
+    // Decoded fine, but we can't write it back out identically, so it's read only
+    ReEncodingFailed,
+};
+
+struct Diagnostic {
+    DecodeError error = DecodeError::None;
+    int itemIndex = -1; // -1 for the file itself
+    QString message;
+
+    bool isError() const { return error != DecodeError::None && error != DecodeError::ReEncodingFailed; }
+};
+
+// Collects what went wrong while decoding, so the codec doesn't have to pop
+// up dialogs (or even be on the GUI thread) and the UI can show it all once.
+class DecodeReport
+{
+public:
+    void add(const DecodeError error, const QString &message, const int itemIndex = -1);
+    void add(const Diagnostic &diagnostic);
+    void clear() { m_diagnostics.clear(); }
+
+    bool isEmpty() const { return m_diagnostics.isEmpty(); }
+    const QVector<Diagnostic> &diagnostics() const { return m_diagnostics; }
+
+    int failedItemsCount() const;
+
+    // Anything other than warnings like ReEncodingFailed
+    bool hasErrors() const;
+
+    // Human readable, one line per diagnostic
+    QString toText() const;
+
+    // Short one line summary, like "ChecksumMismatch x2, InvalidPart x1"
+    QString errorCounts(const bool includeWarnings = true) const;
+
+    static QString errorName(const DecodeError error);
+
+private:
+    QVector<Diagnostic> m_diagnostics;
+};
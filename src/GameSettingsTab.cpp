@@ -1,6 +1,6 @@
 #include "GameSettingsTab.h"
 
-#include "Savegame.h"
+#include "Profile.h"
 
 #include <QVBoxLayout>
 #include <QSpinBox>
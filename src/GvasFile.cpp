@@ -0,0 +1,305 @@
+#include "GvasFile.h"
+
+#include "obfuscation.h"
+
+#include <google/protobuf/message_lite.h>
+
+#include <QBuffer>
+#include <QSaveFile>
+#include <QtEndian> // all the qFromLittleEndian is valid for the PC saves at least
+#include <QDebug>
+#include <cstring>
+#include <limits>
+
+// Reads straight out of the memory mapped file, so we don't do a syscall for every tiny field
+struct ByteReader
+{
+    ByteReader(const uchar *data, const qint64 size) :
+        m_data(reinterpret_cast<const char*>(data)),
+        m_size(size)
+    {}
+
+    qint64 bytesLeft() const { return m_size - m_pos; }
+    const char *current() const { return m_data + m_pos; }
+
+    // Returns nullptr and doesn't move if there isn't enough left
+    const char *read(const qint64 count) {
+        if (count < 0 || count > bytesLeft()) {
+            return nullptr;
+        }
+        const char *ret = current();
+        m_pos += count;
+        return ret;
+    }
+
+private:
+    const char *m_data;
+    qint64 m_size;
+    qint64 m_pos = 0;
+};
+
+template <typename T>
+static bool readInt(T *output, ByteReader *input)
+{
+    const char *data = input->read(sizeof(T));
+    if (!data) {
+        return false;
+    }
+    *output = qFromLittleEndian<T>(data);
+    return true;
+}
+
+template <typename T>
+static bool writeInt(const T input, QIODevice *output)
+{
+    char data[sizeof(T)];
+    qToLittleEndian(input, data);
+    const qint64 written = output->write(data, sizeof(data));
+    if (written != qint64(sizeof(data))) {
+        qWarning() << "short writE" << written << sizeof(data);
+        return false;
+    }
+    return true;
+}
+
+static bool readString(QString *output, ByteReader *input)
+{
+    int stringLength;
+    if (!readInt(&stringLength, input) || stringLength < 0) {
+        return false;
+    }
+    const char *data = input->read(stringLength);
+    if (!data) {
+        return false;
+    }
+
+    // just an empty string, because it's supposed to be 0 terminated
+    if (stringLength <= 1) {
+        return true;
+    }
+    *output = QString::fromUtf8(data, stringLength - 1); // Supposed to be \0-terminated, but just in case
+    return true;
+}
+
+static bool writeString(const QString &input, QIODevice *output)
+{
+    const QByteArray utf8 = input.toUtf8() + '\0';
+    const int stringLength = utf8.length();
+    if (!writeInt(stringLength, output) || stringLength < 0) {
+        return false;
+    }
+
+    output->write(utf8);
+
+    return true;
+}
+
+GvasFile::~GvasFile()
+{
+    close();
+}
+
+void GvasFile::close()
+{
+    if (m_isMapped) {
+        m_file.unmap(const_cast<uchar*>(m_data));
+    }
+    m_file.close();
+    m_fileContents.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_isMapped = false;
+    m_bodyOffset = 0;
+}
+
+bool GvasFile::open(const QString &filePath, DecodeReport *report)
+{
+    close();
+    m_header = {};
+
+    m_file.setFileName(filePath);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        report->add(DecodeError::FileOpenFailed, QObject::tr("Failed to open file: %1").arg(m_file.errorString()));
+        return false;
+    }
+
+    // Map it so we can read the header in place, and deobfuscate the body
+    // straight into the buffer that protobuf parses
+    m_data = m_file.map(0, m_file.size());
+    m_isMapped = m_data != nullptr;
+    if (!m_isMapped) {
+        qWarning() << "Failed to map file, reading instead:" << m_file.errorString();
+        m_fileContents = m_file.readAll();
+        m_data = reinterpret_cast<const uchar*>(m_fileContents.constData());
+    }
+    m_size = m_file.size();
+    ByteReader reader(m_data, m_size);
+
+    const char *fileMagic = reader.read(4);
+    if (!fileMagic || memcmp(fileMagic, "GVAS", 4) != 0) {
+        report->add(DecodeError::InvalidMagic, QObject::tr("Invalid file, starts with: '%1'.").arg(QString::fromLatin1(QByteArray(reinterpret_cast<const char*>(m_data), int(qMin<qint64>(4, m_size))).toHex())));
+        return false;
+    }
+    bool couldReadHeader =
+            readInt(&m_header.savegameVersion, &reader) &&
+            readInt(&m_header.packageVersion, &reader) &&
+            readInt(&m_header.engineMajorVersion, &reader) &&
+            readInt(&m_header.engineMinorVersion, &reader) &&
+            readInt(&m_header.enginePatchVersion, &reader) &&
+            readInt(&m_header.engineBuild, &reader) &&
+            readString(&m_header.buildId, &reader) &&
+            readInt(&m_header.customFormatVersion, &reader) &&
+            readInt(&m_header.customFormatCount, &reader);
+
+    if (!couldReadHeader) {
+        report->add(DecodeError::TruncatedHeader, QObject::tr("Invalid file, failed to read header (file too short)."));
+        return false;
+    }
+    if (m_header.customFormatCount > 1000) { // idk, just sanity
+        report->add(DecodeError::TooManyCustomFormats, QObject::tr("Invalid file, too many custom formats: %1").arg(m_header.customFormatCount));
+        return false;
+    }
+//    qDebug() << "Custom formats" << m_header.customFormatCount;
+
+    m_header.customFormats.resize(m_header.customFormatCount);
+
+    for (Header::CustomFormat &format : m_header.customFormats) {
+        const char *uuid = reader.read(16);
+        if (!uuid) {
+            report->add(DecodeError::TruncatedHeader, QObject::tr("Invalid file, failed to read custom format description id"));
+            return false;
+        }
+        format.id = QUuid::fromRfc4122(QByteArray::fromRawData(uuid, 16));
+        if (format.id.isNull()) {
+            report->add(DecodeError::InvalidCustomFormat, QObject::tr("Invalid custom format description id"));
+            return false;
+        }
+        if (!readInt(&format.entry, &reader)) {
+            report->add(DecodeError::TruncatedHeader, QObject::tr("Invalid file, failed to read custom format entry index."));
+            return false;
+        }
+//        qDebug() << "Format" << format.id << format.entry;
+    }
+    if (!readString(&m_header.savegameType, &reader)) {
+        report->add(DecodeError::TruncatedHeader, QObject::tr("Invalid file, failed to read savegame type."));
+        return false;
+    }
+    if (!readInt(&m_header.dataLength, &reader)) {
+        report->add(DecodeError::TruncatedHeader, QObject::tr("Failed to read data length"));
+        return false;
+    }
+
+    qDebug() << "Savegame version" << m_header.savegameType << m_header.savegameVersion;
+    qDebug() << "Package version" << m_header.packageVersion;
+    qDebug() << "Build id:" << m_header.buildId;
+    qDebug() << "Engine version" << m_header.engineMajorVersion << m_header.engineMinorVersion << m_header.enginePatchVersion << m_header.engineBuild;
+    qDebug() << "Custom format version" << m_header.customFormatVersion;
+
+
+    if (reader.bytesLeft() != m_header.dataLength) { // yeah yeah, padding, but it needs to be significantly larger so whatever
+        report->add(DecodeError::WrongDataLength, QObject::tr("Wrong amount of data available, expected %1, but got %2").arg(m_header.dataLength).arg(reader.bytesLeft()));
+        return false;
+    }
+
+    m_bodyOffset = reader.current() - reinterpret_cast<const char*>(m_data);
+
+    return true;
+}
+
+bool GvasFile::parseBody(google::protobuf::MessageLite *message, DecodeReport *report) const
+{
+    if (!m_data) {
+        qWarning() << "File not open";
+        return false;
+    }
+
+    // Deobfuscated straight from the mapped file into the buffer protobuf parses
+    QByteArray data(m_header.dataLength, Qt::Uninitialized);
+    obfuscation::deobfuscateBody(reinterpret_cast<const char*>(m_data) + m_bodyOffset, data.data(), size_t(data.size()));
+
+    if (!message->ParseFromArray(data.constData(), data.size())) {
+        // protobuf never gives us anything, but whatever
+        report->add(DecodeError::ProtobufParseFailed, QObject::tr("Failed to parse file contents (protobuf parse failed):\n%1").arg(QString::fromStdString(message->InitializationErrorString())));
+        return false;
+    }
+
+    if (!message->IsInitialized()) {
+        report->add(DecodeError::ProtobufNotInitialized, QObject::tr("Failed to parse file contents (protobuf not initialized):\n%1").arg(QString::fromStdString(message->InitializationErrorString())));
+        return false;
+    }
+
+    return true;
+}
+
+QByteArray GvasFile::rawContents() const
+{
+    if (!m_data) {
+        return {};
+    }
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(m_data), int(m_size));
+}
+
+QString GvasFile::write(const QString &filePath, const Header &header, const google::protobuf::MessageLite &message)
+{
+    // Header is small, so just build it in memory first
+    QByteArray output;
+    QBuffer headerBuffer(&output);
+    headerBuffer.open(QIODevice::WriteOnly);
+    headerBuffer.write("GVAS");
+    bool couldWriteHeader =
+            writeInt(header.savegameVersion, &headerBuffer) &&
+            writeInt(header.packageVersion, &headerBuffer) &&
+            writeInt(header.engineMajorVersion, &headerBuffer) &&
+            writeInt(header.engineMinorVersion, &headerBuffer) &&
+            writeInt(header.enginePatchVersion, &headerBuffer) &&
+            writeInt(header.engineBuild, &headerBuffer) &&
+            writeString(header.buildId, &headerBuffer) &&
+            writeInt(header.customFormatVersion, &headerBuffer) &&
+            writeInt(header.customFormatCount, &headerBuffer);
+
+    for (const Header::CustomFormat &format : header.customFormats) {
+        couldWriteHeader = couldWriteHeader &&
+            headerBuffer.write(format.id.toRfc4122()) == 16 &&
+            writeInt(format.entry, &headerBuffer);
+    }
+    couldWriteHeader = couldWriteHeader && writeString(header.savegameType, &headerBuffer);
+    headerBuffer.close();
+
+    if (!couldWriteHeader) {
+        return QObject::tr("Failed to write header");
+    }
+
+    // Serialize straight into the output buffer after the header and length,
+    // instead of going via std::string and another QByteArray
+    const size_t dataLength = message.ByteSizeLong(); // also caches the sizes for below
+    if (dataLength > size_t(std::numeric_limits<int>::max()) - size_t(output.size()) - sizeof(int)) {
+        return QObject::tr("Savegame is too big");
+    }
+    const int headerSize = output.size();
+    output.resize(headerSize + int(sizeof(int)) + int(dataLength));
+    qToLittleEndian(int(dataLength), output.data() + headerSize);
+
+    char *data = output.data() + headerSize + sizeof(int);
+    uint8_t *dataEnd = message.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(data));
+    if (reinterpret_cast<char*>(dataEnd) != data + dataLength) {
+        return QObject::tr("Failed to serialize savegame");
+    }
+    obfuscation::obfuscateBody(data, dataLength);
+
+    // Written to a temporary file and renamed over the old one in commit(),
+    // so crashing or running out of space halfway doesn't destroy the save
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return QObject::tr("Failed to open file: %1").arg(file.errorString());
+    }
+    if (file.write(output) != output.size()) {
+        const QString error = file.errorString();
+        file.cancelWriting();
+        return QObject::tr("Failed to write file: %1").arg(error);
+    }
+    if (!file.commit()) {
+        return QObject::tr("Failed to save file: %1").arg(file.errorString());
+    }
+
+    return {};
+}
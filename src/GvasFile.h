@@ -0,0 +1,73 @@
+#pragma once
+
+#include "DecodeReport.h"
+
+#include <QFile>
+#include <QString>
+#include <QUuid>
+#include <QVector>
+
+namespace google {
+namespace protobuf {
+class MessageLite;
+}
+}
+
+// The Unreal savegame container, used by both the savegames and the profile.
+// A header, and then the obfuscated protobuf data.
+class GvasFile
+{
+public:
+    struct Header {
+        uint32_t savegameVersion;
+        uint32_t packageVersion;
+
+        uint16_t engineMajorVersion;
+        uint16_t engineMinorVersion;
+        uint16_t enginePatchVersion;
+
+        uint32_t engineBuild;
+        QString buildId;
+
+        uint32_t customFormatVersion;
+        uint32_t customFormatCount;
+
+        struct CustomFormat {
+            QUuid id;
+            int entry = 0;
+        };
+        QVector<CustomFormat> customFormats;
+
+        QString savegameType;
+
+        int32_t dataLength;
+    };
+
+    ~GvasFile();
+
+    // Maps the file and reads the header, the file stays mapped until close()
+    bool open(const QString &filePath, DecodeReport *report);
+    void close();
+
+    // Deobfuscates the data and parses it into the message
+    bool parseBody(google::protobuf::MessageLite *message, DecodeReport *report) const;
+
+    const Header &header() const { return m_header; }
+    QString fileName() const { return m_file.fileName(); }
+
+    // Not copied, only valid until close()
+    QByteArray rawContents() const;
+
+    // Returns an error message if it fails, written atomically
+    static QString write(const QString &filePath, const Header &header, const google::protobuf::MessageLite &message);
+
+private:
+    Header m_header{};
+
+    QFile m_file;
+    QByteArray m_fileContents; // if mapping fails
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+    bool m_isMapped = false;
+    qint64 m_bodyOffset = 0;
+};
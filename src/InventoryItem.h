@@ -1,8 +1,14 @@
 #pragma once
 
+#include "StringPool.h"
+
 #include <QString>
 #include <QVector>
 #include <QByteArray>
+#include <string>
+
+// Index of a serial category in ItemData, see ItemData::categoryHandle()
+using CategoryHandle = int;
 
 struct InventoryItem {
     enum Flag {
@@ -27,17 +33,28 @@ struct InventoryItem {
                 ;
     }
 
+    // Only enough to show it in a list until it is actually used
+    bool isHeaderValid() const {
+        return version != -1 &&
+                !name.isEmpty() &&
+                balance.isValid() &&
+                data.isValid() &&
+                manufacturer.isValid() &&
+                level != -1;
+    }
+    bool fullyDecoded = false;
+
     int version = -1;
 
-    QString partsCategory;
+    CategoryHandle partsCategory = -1;
 
     struct Aspect {
         int bits = -1;
         int index = -1;
-        QString val;
+        StringId val = StringPool::null; // the asset path, StringPool::string() to show it
 
         bool isValid() const {
-            return bits > 0 && index > 0 && !val.isEmpty();
+            return bits > 0 && index > 0 && val != StringPool::null;
         }
     };
 
@@ -60,4 +77,14 @@ struct InventoryItem {
     int numCustom = -1;
 
     QByteArray remainingBits; // TODO
+    int remainingBitsCount = 0;
+
+    // The serial it was decoded from or last encoded to, so we don't have to
+    // encode it again until it is changed. Edits call markChanged().
+    std::string serial;
+    int generation = 0;
+    int serialGeneration = -1;
+
+    bool isSerialCurrent() const { return serialGeneration == generation && !serial.empty(); }
+    void markChanged() { generation++; }
 };
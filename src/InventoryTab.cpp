@@ -105,7 +105,7 @@ void InventoryTab::onItemSelected()
     QSignalBlocker itemLevelBlocker(m_itemLevel);
 
     m_partsList->clear();
-    m_enabledParts.clear();
+    m_partSelection.reset();
 
     m_partName->setText({});
     m_partEffects->setText({});
@@ -127,11 +127,13 @@ void InventoryTab::onItemSelected()
 
     m_itemLevel->setValue(currentInventoryItem.level);
 
+    m_partSelection.reset(new PartSelection(&ItemData::partConstraints(currentInventoryItem.objectShortName)));
+
     QMap<QString, QString> partCategories;
     QSet<QString> categories;
     for (const ItemPart &part : ItemData::weaponParts(currentInventoryItem.objectShortName)) {
-        partCategories[part.partId] = part.category;
-        categories.insert(part.category);
+        partCategories[StringPool::string(part.partId)] = StringPool::string(part.category);
+        categories.insert(StringPool::string(part.category));
     }
 
 
@@ -144,7 +146,7 @@ void InventoryTab::onItemSelected()
 
     QStringList nameText, effectsText, negativesText, positivesText;
 
-    const QString assetId = currentInventoryItem.data.val.split('.').last();
+    const QString assetId = StringPool::string(currentInventoryItem.data.val).split('.').last();
     if (ItemData::hasItemInfo(assetId)) {
         const ItemInfo &info = ItemData::itemInfo(assetId);
         if (!info.inventoryName.isEmpty()) {
@@ -170,9 +172,8 @@ void InventoryTab::onItemSelected()
     for (int partIndex = 0; partIndex < currentInventoryItem.parts.count(); partIndex++) {
         const InventoryItem::Aspect &part = currentInventoryItem.parts[partIndex];
 
-        const QString name = part.val.split('.').last();
-        m_enabledParts.insert(name);
-
+        const QString name = StringPool::string(part.val).split('.').last();
+        m_partSelection->setEnabled(StringPool::intern(name), true);
 
         QString category;
 
@@ -216,7 +217,7 @@ void InventoryTab::onItemSelected()
         QTreeWidgetItem *listItem = new QTreeWidgetItem(categoryItems[partCategories[partId]], {makeNamePretty(partId)});
         listItem->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsUserCheckable);
         listItem->setData(0, Qt::UserRole, partId);
-        if (m_enabledParts.contains(partId)) {
+        if (m_partSelection->isEnabled(StringPool::find(partId))) {
             listItem->setCheckState(0, Qt::Checked);
         } else {
             listItem->setCheckState(0, Qt::Unchecked);
@@ -285,12 +286,14 @@ void InventoryTab::onPartChanged(QTreeWidgetItem *item, int column)
 
     if (!enabled) {
         m_savegame->removeInventoryItemPart(m_selectedInventoryItem, item->data(0, Qt::UserRole).toString());
-        m_enabledParts.remove(item->data(0, Qt::UserRole).toString());
+        if (m_partSelection) {
+            m_partSelection->setEnabled(StringPool::find(item->data(0, Qt::UserRole).toString()), false);
+        }
         checkValidity();
         return;
     }
 
-    const InventoryItem &currentInventoryItem = m_savegame->items()[m_selectedInventoryItem];
+    const InventoryItem &currentInventoryItem = m_savegame->inventoryItem(m_selectedInventoryItem);
     qDebug() << itemId << "Part category" << itemPartCategory;
     InventoryItem::Aspect part = ItemData::createInventoryItemPart(currentInventoryItem, itemId);
     if (part.index <= 0) {
@@ -299,7 +302,9 @@ void InventoryTab::onPartChanged(QTreeWidgetItem *item, int column)
         return;
     }
     m_savegame->addInventoryItemPart(m_selectedInventoryItem, part);
-    m_enabledParts.insert(item->data(0, Qt::UserRole).toString());
+    if (m_partSelection) {
+        m_partSelection->setEnabled(StringPool::intern(item->data(0, Qt::UserRole).toString()), true);
+    }
 //    qDebug() << "existing index" << existingPartPosition << "new part name" << part.val;
     checkValidity();
 }
@@ -324,77 +329,55 @@ void InventoryTab::checkValidity()
     m_warningText->clear();
     m_warningText->hide();
 
-    QString warningText;
-
-    QHash<QString, int> maxInCategories;
-    QHash<QString, int> minInCategories;
-    QHash<QString, int> enabledInCategories;
-
     if (m_selectedInventoryItem <= 0) {
         return;
     }
     const InventoryItem &currentInventoryItem = m_savegame->inventoryItem(m_selectedInventoryItem);
     if (!currentInventoryItem.isValid()) {
         qWarning() << "Current invalid";
+        m_warningText->setText(tr("Failed to decode this item, so it can't be edited."));
+        m_warningText->show();
+        return;
+    }
+    if (!m_partSelection || m_partSelection->isValid()) {
         return;
     }
 
-    QSet<QString> partsToProcess = m_enabledParts;
-    for (const ItemPart &part : ItemData::weaponParts(currentInventoryItem.objectShortName)) {
-        if (!partsToProcess.contains(part.partId)) {
-            continue;
-        }
-        partsToProcess.remove(part.partId);
-        if (!maxInCategories.contains(part.category)) {
-            maxInCategories[part.category] = part.maxParts;
-        } else {
-            maxInCategories[part.category] = qMax(part.maxParts, maxInCategories[part.category]);
-        }
-
-        if (!minInCategories.contains(part.category)) {
-            minInCategories[part.category] = part.minParts;
-        } else {
-            minInCategories[part.category] = qMin(part.minParts, minInCategories[part.category]);
+    // Same engine as batch mode uses, we just make it readable
+    const PartConstraints &constraints = ItemData::partConstraints(currentInventoryItem.objectShortName);
+    QString warningText;
+    int unknownParts = 0;
+    for (const PartConstraints::Violation &violation : m_partSelection->violations()) {
+        switch(violation.type) {
+        case PartConstraints::Violation::MissingDependency: {
+            QStringList requiredPrettyNames;
+            constraints.dependencies(violation.part).forEach([&](const int required) {
+                requiredPrettyNames.append(makeNamePretty(StringPool::string(constraints.partId(required))));
+            });
+            warningText += tr("%1 requires one of: %2\n").arg(makeNamePretty(StringPool::string(constraints.partId(violation.part))), makeNamePretty(requiredPrettyNames.join(", ")));
+            break;
         }
-
-        bool hasRequired = part.dependencies.isEmpty();
-        QStringList requiredPrettyNames;
-        for (const QString &required : part.dependencies) {
-            if (required.isEmpty()) {
-                qWarning() << "Empty dependency for" << part.partId;
-                continue;
-            }
-            requiredPrettyNames.append(makeNamePretty(required));
-            if (m_enabledParts.contains(required)) {
-                hasRequired = true;
-            }
+        case PartConstraints::Violation::Excluded:
+            warningText += tr("%1 can't be combined with %2\n").arg(makeNamePretty(StringPool::string(constraints.partId(violation.part))), makeNamePretty(StringPool::string(constraints.partId(violation.other))));
+            break;
+        case PartConstraints::Violation::TooFewParts: {
+            const PartConstraints::Category &category = constraints.category(violation.category);
+            warningText += tr("Category %1 requires at least %2 parts, only has %3\n").arg(StringPool::string(category.name)).arg(category.minParts).arg(violation.count);
+            break;
         }
-        if (!hasRequired) {
-            warningText += tr("%1 requires one of: %2\n").arg(makeNamePretty(part.partId), makeNamePretty(requiredPrettyNames.join(", ")));
+        case PartConstraints::Violation::TooManyParts: {
+            const PartConstraints::Category &category = constraints.category(violation.category);
+            warningText += tr("Category %1 can only have %2 parts, has %3\n").arg(StringPool::string(category.name)).arg(category.maxParts).arg(violation.count);
+            break;
         }
-        for (const QString &excluder : part.excluders) {
-            if (excluder.isEmpty()) {
-                qWarning() << "Empty excluder for" << part.partId;
-                continue;
-            }
-            if (m_enabledParts.contains(excluder)) {
-                warningText += tr("%1 can't be combined with %2\n").arg(makeNamePretty(part.partId), makeNamePretty(excluder));
-            }
+        case PartConstraints::Violation::UnknownPart:
+            qDebug() << StringPool::string(violation.unknownPart);
+            unknownParts++;
+            break;
         }
-        enabledInCategories[part.category]++;
     }
-    if (!partsToProcess.isEmpty()) {
-        warningText += tr("%1 unknown parts for current item\n").arg(partsToProcess.count());
-        qDebug() << partsToProcess;
-    }
-    for (const QString &category : enabledInCategories.keys()) {
-        const int count = enabledInCategories[category];
-        if (count < minInCategories[category]) {
-            warningText += tr("Category %1 requires at least %2 parts, only has %3\n").arg(category).arg(minInCategories[category]).arg(count);
-        }
-        if (count > maxInCategories[category]) {
-            warningText += tr("Category %1 can only have %2 parts, has %3\n").arg(category).arg(maxInCategories[category]).arg(count);
-        }
+    if (unknownParts > 0) {
+        warningText += tr("%1 unknown parts for current item\n").arg(unknownParts);
     }
     if (!warningText.isEmpty()) {
         m_warningText->setText(warningText);
@@ -1,8 +1,12 @@
 #ifndef INVENTORYTAB_H
 #define INVENTORYTAB_H
 
+#include "StringPool.h"
+#include "PartConstraints.h"
+
 #include <QWidget>
-#include <QSet>
+
+#include <memory>
 
 class QListWidget;
 class QTreeWidget;
@@ -31,7 +35,7 @@ private:
     Savegame *m_savegame;
     QListWidget *m_list;
     QTreeWidget *m_partsList;
-    QSet<QString> m_enabledParts;
+    std::unique_ptr<PartSelection> m_partSelection; // the enabled parts, only rechecks what changes when a part is flipped
 
     QLabel *m_partName;
     QLabel *m_partEffects;
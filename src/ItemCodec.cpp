@@ -0,0 +1,366 @@
+#include "ItemCodec.h"
+
+#include "ItemData.h"
+#include "obfuscation.h"
+#include "BitParser.h"
+#include "Crc32.h"
+
+#include <QtConcurrent>
+#include <QtEndian>
+#include <QDebug>
+
+// Normal crc32 over the 5 header bytes, the checksum field set to 0xFFFF and
+// then the payload, folded to 16 bits
+static uint16_t itemChecksum(const char *header, const char *payload, const int payloadSize)
+{
+    Crc32 crc;
+    crc.update(header, 5);
+    crc.update("\xff\xff", 2);
+    crc.update(payload, size_t(payloadSize));
+
+    const uint32_t crc32 = crc.value();
+    return (crc32 >> 16) ^ crc32;
+}
+
+namespace {
+// The ones every item has, so we only look them up once (the handles stay
+// the same when the item data is reloaded)
+struct FixedCategories {
+    CategoryHandle balance = ItemData::categoryHandle(QStringLiteral("InventoryBalanceData"));
+    CategoryHandle data = ItemData::categoryHandle(QStringLiteral("InventoryData"));
+    CategoryHandle manufacturer = ItemData::categoryHandle(QStringLiteral("ManufacturerData"));
+    CategoryHandle genericParts = ItemData::categoryHandle(QStringLiteral("InventoryGenericPartData"));
+};
+
+const FixedCategories &fixedCategories()
+{
+    static const FixedCategories categories;
+    return categories;
+}
+} // namespace
+
+static QByteArray deobfuscateItem(const QByteArray &input, Diagnostic *diagnostic)
+{
+    // 3, the seed and the checksum, anything shorter and we'd read past the end
+    if (input.size() < 7) {
+        diagnostic->error = DecodeError::SerialTooShort;
+        diagnostic->message = QObject::tr("Invalid item serial (too short: %1).").arg(input.size());
+        return {};
+    }
+    if (input[0] != 3) {
+        diagnostic->error = DecodeError::InvalidSerialStart;
+        diagnostic->message = QObject::tr("Invalid item (item serial doesn't start with 3, got %1).").arg(int(input[0]));
+        return {};
+    }
+
+    const int32_t seed = qFromBigEndian<int32_t>(input.data() + 1);
+
+    QByteArray data = input.mid(5); // 1 first byte is 3, 4 bytes is int seed
+
+    if (seed != 0) {
+        uint32_t key = (seed >> 5) & 0xFFFFFFFF;
+        for (char &c : data) {
+            key = (key * obfuscation::itemKey) % obfuscation::itemMask;
+            c ^= key;
+        }
+        const int steps = (seed & 0x1f) % data.size();
+        std::rotate(data.rbegin(), data.rbegin() + steps, data.rend());
+    } else {
+        qWarning() << "0 seed?";
+    }
+
+    const uint16_t computedChecksum = itemChecksum(input.constData(), data.constData() + 2, data.size() - 2);
+    const uint16_t checksum = qFromBigEndian<uint16_t>(data.data());
+    if (computedChecksum != checksum) {
+        diagnostic->error = DecodeError::ChecksumMismatch;
+        diagnostic->message = QObject::tr("Invalid item (checksum failed, got %1, expected %2).").arg(computedChecksum).arg(checksum);
+        return {};
+    }
+
+    return data.mid(2);
+}
+
+// extremely inefficient, but can't be bothered to think
+static QByteArray obfuscateItem(QByteArray input, const int seed)
+{
+    if (input.isEmpty()) {
+        qWarning() << "Can't obfuscate empty string";
+        return {};
+    }
+
+    QByteArray ret(5, 0);
+    ret[0] = 3;
+    qToBigEndian(seed, ret.data() + 1);
+
+    const uint16_t computedChecksum = itemChecksum(ret.constData(), input.constData(), input.size());
+
+    QByteArray checksumBytes(sizeof(computedChecksum), 0);
+    qToBigEndian(computedChecksum, checksumBytes.data());
+    input.prepend(checksumBytes);
+
+    if (seed != 0) {
+        const int steps = (seed & 0x1f) % input.size();
+        std::rotate(input.begin(), input.begin() + steps, input.end());
+        uint32_t key = (seed >> 5) & 0xFFFFFFFF;
+        for (char &c : input) {
+            key = (key * obfuscation::itemKey) % obfuscation::itemMask;
+            c ^= key;
+        }
+    }
+
+    ret.append(input);
+
+    return ret;
+}
+
+InventoryItem ItemCodec::decode(const std::string &serial, Diagnostic *diagnostic)
+{
+    // Same data for decoding and checking it, even if it is reloaded meanwhile
+    ItemData::Pin pin;
+
+    InventoryItem item = parse(serial, diagnostic);
+    if (!item.isValid()) {
+        return item;
+    }
+
+    // Not serialize(), that would just give us back the serial we started with
+    const std::string reEncoded = encode(item);
+    if (serial == reEncoded){
+        item.writable = true;
+    } else {
+        diagnostic->error = DecodeError::ReEncodingFailed;
+        diagnostic->message = QObject::tr("Re-encoding %1 failed, it can't be edited.").arg(item.name);
+        qWarning() << "Re-encoding failed" << item.objectShortName;
+
+        // Only bother checking the obfuscation when something is wrong
+        Diagnostic ignored;
+        const QByteArray deobfuscated = deobfuscateItem(QByteArray::fromStdString(serial), &ignored);
+        if (serial != obfuscateItem(deobfuscated, item.seed).toStdString()) {
+            qWarning() << "OBfuscation failed" << deobfuscated.toHex(' ');
+        }
+        qDebug() << "Encoded: " << QByteArray::fromStdString(reEncoded).toHex(' ');
+        qDebug() << "Original:" << QByteArray::fromStdString(serial).toHex(' ');
+    }
+
+    return item;
+}
+
+InventoryItem ItemCodec::parse(const std::string &obfuscatedSerial, Diagnostic *diagnostic, const bool headerOnly)
+{
+    ItemData::Pin pin;
+
+    QByteArray serial = deobfuscateItem(QByteArray::fromStdString(obfuscatedSerial), diagnostic);
+    if (serial.isEmpty()) {
+        qWarning() << "Couldn't deobfuscate";
+        return {};
+    }
+
+    BitParser bits(serial);
+    if (bits.eat(8) != 128) {
+        qWarning() << "Invalid start";
+        diagnostic->error = DecodeError::InvalidItemStart;
+        diagnostic->message = QObject::tr("Item data has wrong start.");
+        return {};
+    }
+
+    InventoryItem item;
+    item.serial = obfuscatedSerial;
+    item.serialGeneration = item.generation;
+    item.version = bits.eat(7);
+    item.seed = qFromBigEndian<int32_t>(obfuscatedSerial.data() + 1);
+    if (item.version > maxVersion) {
+        diagnostic->error = DecodeError::UnsupportedVersion;
+        diagnostic->message = QObject::tr("Item version is too high (%1, we only support %2)").arg(item.version).arg(maxVersion);
+        item.remainingBits = bits.remaining();
+        item.remainingBitsCount = bits.bitsLeft();
+        return item;
+    }
+    const FixedCategories &categories = fixedCategories();
+    item.balance = getAspect(categories.balance, item.version, &bits);
+    if (!item.balance.isValid()) {
+        diagnostic->error = DecodeError::InvalidBalance;
+        diagnostic->message = QObject::tr("Invalid item balance");
+        qWarning() << "Invalid item balance";
+        item.remainingBits = bits.remaining();
+        item.remainingBitsCount = bits.bitsLeft();
+        return item;
+    }
+
+    const StringId shortName = ItemData::objectShortName(item.balance.val);
+    item.objectShortName = StringPool::string(shortName);
+    item.name = ItemData::englishName(shortName);
+
+    item.data = getAspect(categories.data, item.version, &bits); // these seem wrong
+    if (!item.data.isValid()) {
+        diagnostic->error = DecodeError::InvalidData;
+        diagnostic->message = QObject::tr("Invalid item data for %1").arg(item.name);
+        item.remainingBits = bits.remaining();
+        item.remainingBitsCount = bits.bitsLeft();
+        return item;
+    }
+    item.manufacturer = getAspect(categories.manufacturer, item.version, &bits);
+    if (!item.manufacturer.isValid()) {
+        diagnostic->error = DecodeError::InvalidManufacturer;
+        diagnostic->message = QObject::tr("Invalid item manufacturer for %1").arg(item.name);
+        item.remainingBits = bits.remaining();
+        item.remainingBitsCount = bits.bitsLeft();
+        return item;
+    }
+    item.level = bits.eat(7);
+    if (headerOnly) {
+        return item;
+    }
+    item.fullyDecoded = true;
+
+    item.numberOfParts = bits.eat(6);
+
+    item.partsCategory = ItemData::partCategory(item.balance.val);
+    bool itemFailed = false;
+    if (item.partsCategory >= 0) {
+        for (int partIndex = 0; partIndex < item.numberOfParts; partIndex++) {
+            InventoryItem::Aspect part = getAspect(item.partsCategory, item.version, &bits);
+            if (!part.isValid()) {
+                qWarning() << "Invalid" << StringPool::string(item.balance.val) << ItemData::categoryName(item.partsCategory);
+                diagnostic->error = DecodeError::InvalidPart;
+                diagnostic->message = QObject::tr("Failed to get item part %1 for item %2.").arg(partIndex).arg(item.name);
+                itemFailed = true;
+                break;
+                //                    return false;
+            }
+            item.parts.append(part);
+        }
+    } else {
+        qWarning() << "Item not in parts database:" << StringPool::string(item.balance.val);
+        diagnostic->error = DecodeError::UnknownPartCategory;
+        diagnostic->message = QObject::tr("%1 is not in the parts database").arg(StringPool::string(item.balance.val));
+        itemFailed = true;
+    }
+
+    if (!itemFailed) {
+        const int genericPartsCount = bits.eat(4);
+        for (int partIndex = 0; partIndex < genericPartsCount; partIndex++) {
+            InventoryItem::Aspect genericPart = getAspect(categories.genericParts, item.version, &bits);
+            if (!genericPart.isValid()) {
+                qWarning() << "Invalid generic item part number" << partIndex;
+                diagnostic->error = DecodeError::InvalidGenericPart;
+                diagnostic->message = QObject::tr("Failed to get generic part %1 for item %2.").arg(partIndex).arg(item.name);
+                itemFailed = true;
+                break;
+            }
+            item.genericParts.append(genericPart);
+            qDebug() << "Got generic part" << genericPart.index;
+        }
+    }
+
+    if (!itemFailed) {
+        const int itemWearCount = bits.eat(8);
+        for (int index = 0; index<itemWearCount; index++) {
+            item.itemWearMaybe.append(bits.eat(8));
+        }
+        item.numCustom = bits.eat(4);
+        if (item.numCustom > 0) {
+            qWarning() << "We don't know what num custom is, we have" << item.numCustom;
+        }
+    }
+
+    if (!itemFailed) {
+        if (bits.bitsLeft() > 7 || !bits.remainingIsZero()) {
+            qWarning() << "There should be only zero padding left, we have" << bits.bitsLeft() << "bits:" << bits.remaining().toHex();
+        }
+    }
+
+    item.remainingBits = bits.remaining();
+    item.remainingBitsCount = bits.bitsLeft();
+
+    return item;
+}
+
+std::string ItemCodec::serialize(const InventoryItem &item)
+{
+    if (item.isSerialCurrent()) {
+        return item.serial;
+    }
+    return encode(item);
+}
+
+std::string ItemCodec::encode(const InventoryItem &item)
+{
+    ItemData::Pin pin;
+    const FixedCategories &categories = fixedCategories();
+
+    BitParser bits;
+    bits.put(128, 8);
+    bits.put(item.version, 7);
+    putAspect(item.balance, categories.balance, item.version, &bits);
+    putAspect(item.data, categories.data, item.version, &bits);
+    putAspect(item.manufacturer, categories.manufacturer, item.version, &bits);
+    bits.put(item.level, 7);
+    bits.put(item.parts.count(), 6);
+
+    // Resolved when it was decoded
+    for (const InventoryItem::Aspect &part : item.parts) {
+        putAspect(part, item.partsCategory, item.version, &bits);
+    }
+
+    bits.put(item.genericParts.count(), 4);
+    for (const InventoryItem::Aspect &genericPart : item.genericParts) {
+        putAspect(genericPart, categories.genericParts, item.version, &bits);
+    }
+
+    bits.put(item.itemWearMaybe.count(), 8);
+    for (const uint8_t itemWear : item.itemWearMaybe) {
+        bits.put(itemWear, 8);
+    }
+
+    bits.putBits(item.remainingBits, item.remainingBitsCount);
+    return obfuscateItem(bits.toBinaryData(), item.seed).toStdString();
+}
+
+InventoryItem::Aspect ItemCodec::getAspect(const CategoryHandle category, const int requiredVersion, BitParser *bits)
+{
+    InventoryItem::Aspect aspect;
+    aspect.bits = ItemData::requiredBits(category, requiredVersion);
+    if (aspect.bits <= 0) {
+        qWarning() << "Invalid aspect";
+        return {};
+    }
+    aspect.index = bits->eat(aspect.bits);
+    if (aspect.index < 0) {
+        qWarning() << "Invalid index" << aspect.index;
+        return {};
+    }
+    if (aspect.index == 0) { // it is for some weird reason 1-indexed
+        qWarning() << "Zero index for" << ItemData::categoryName(category);
+        return {};
+    }
+    aspect.val = ItemData::getItemAsset(category, aspect.index - 1);
+    if (aspect.val == StringPool::null) {
+        qWarning() << "Can't find val for" << ItemData::categoryName(category) << aspect.index;
+        return {};
+    }
+
+    return aspect;
+}
+
+void ItemCodec::putAspect(const InventoryItem::Aspect &aspect, const CategoryHandle category, const int requiredVersion, BitParser *bits)
+{
+    bits->put(aspect.index, ItemData::requiredBits(category, requiredVersion));
+}
+
+QVector<DecodedItem> ItemCodec::decodeAll(const QVector<const std::string*> &serials, const bool headerOnly)
+{
+    // So they're all decoded with the same data
+    ItemData *snapshot = ItemData::instance();
+
+    // Items don't depend on each other, blockingMapped keeps the order
+    return QtConcurrent::blockingMapped<QVector<DecodedItem>>(serials, [headerOnly, snapshot](const std::string *serial) {
+        ItemData::Pin pin(snapshot);
+        DecodedItem decoded;
+        if (headerOnly) {
+            decoded.item = parse(*serial, &decoded.diagnostic, true);
+        } else {
+            decoded.item = decode(*serial, &decoded.diagnostic);
+        }
+        return decoded;
+    });
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "InventoryItem.h"
+#include "DecodeReport.h"
+
+#include <QVector>
+#include <string>
+
+struct BitParser;
+
+struct DecodedItem {
+    InventoryItem item;
+    Diagnostic diagnostic;
+};
+
+// Item serials to InventoryItem and back, shared by the savegames and the
+// profile (bank etc.). Only touches ItemData and what is passed in, so it
+// can run in any thread.
+class ItemCodec
+{
+public:
+    // Parses everything, and checks that we can write it back identically (sets writable)
+    static InventoryItem decode(const std::string &serial, Diagnostic *diagnostic);
+
+    // headerOnly stops after the level, enough to show it in a list
+    static InventoryItem parse(const std::string &obfuscatedSerial, Diagnostic *diagnostic, const bool headerOnly = false);
+
+    // Only actually encodes it if it has changed since it was decoded or last encoded
+    static std::string serialize(const InventoryItem &item);
+
+    // In parallel, same order as the input
+    static QVector<DecodedItem> decodeAll(const QVector<const std::string*> &serials, const bool headerOnly = false);
+
+    static constexpr int maxVersion = 1000; // todo
+
+private:
+    static std::string encode(const InventoryItem &item);
+
+    static InventoryItem::Aspect getAspect(const CategoryHandle category, const int requiredVersion, BitParser *bits);
+    static void putAspect(const InventoryItem::Aspect &aspect, const CategoryHandle category, const int requiredVersion, BitParser *bits);
+};
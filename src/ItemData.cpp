@@ -1,189 +1,436 @@
 #include "ItemData.h"
 #include <QDebug>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QFile>
-#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+#include <QtConcurrent>
+
+#include <atomic>
+#include <memory>
+#include <vector>
 
 const QVector<ItemPart> ItemData::nullWeaponParts;
+const ItemDescription ItemData::nullDescription;
+const ItemInfo ItemData::nullItemInfo;
+const PartConstraints ItemData::nullPartConstraints;
+const QString ItemData::nullString;
 
-ItemData::ItemData()
+static QVector<StringId> internAll(const QStringList &strings)
 {
-    loadInventorySerials();
+    QVector<StringId> ret;
+    ret.reserve(strings.count());
+    for (const QString &string : strings) {
+        ret.append(StringPool::intern(string));
+    }
+    return ret;
+}
+
+// Readers only ever load s_current (or their pinned one), the rest is only
+// touched with s_reloadMutex held.
+static std::atomic<ItemData*> s_current(nullptr);
+static thread_local ItemData *t_pinned = nullptr;
+static QMutex s_reloadMutex;
+
+// Never deleted until we exit, someone might still be using them
+static std::vector<std::unique_ptr<ItemData>> &snapshots()
+{
+    static std::vector<std::unique_ptr<ItemData>> snapshots;
+    return snapshots;
+}
 
-    QFile namesFile(":/data/english-names.json");
-    namesFile.open(QIODevice::ReadOnly);
-    m_englishNames =  QJsonDocument::fromJson(namesFile.readAll()).object();
+// Shared by all the snapshots, so items decoded with one can be encoded with
+// a newer one. Only added to when loading.
+static QMutex s_categoryHandlesMutex;
+static QHash<QString, CategoryHandle> s_categoryHandles;
 
-    // From cfi2017
-    QFile itemPartCategoriesFile(":/data/balance_to_inv_key.json");
-    itemPartCategoriesFile.open(QIODevice::ReadOnly);
-    m_itemPartCategories = QJsonDocument::fromJson(itemPartCategoriesFile.readAll()).object();
+static CategoryHandle findCategoryHandle(const QString &name)
+{
+    QMutexLocker locker(&s_categoryHandlesMutex);
+    return s_categoryHandles.value(name, -1);
+}
+
+static CategoryHandle addCategoryHandle(const QString &name)
+{
+    QMutexLocker locker(&s_categoryHandlesMutex);
+    QHash<QString, CategoryHandle>::const_iterator it = s_categoryHandles.constFind(name);
+    if (it != s_categoryHandles.constEnd()) {
+        return *it;
+    }
+    const CategoryHandle handle = s_categoryHandles.count();
+    s_categoryHandles.insert(name, handle);
+    return handle;
+}
 
-    QFile weaponPartsFile(":/data/weapon-parts.tsv");
-    weaponPartsFile.open(QIODevice::ReadOnly);
-    weaponPartsFile.readLine(); // Skip header
-    while (!weaponPartsFile.atEnd()) {
-        QStringList line = QString::fromUtf8(weaponPartsFile.readLine()).split('\t');
-        if (line.length() != 11) {
-            qWarning() << "Invalid line in weapon parts file" << line;
+ItemData::ItemData(const QString &databasePath, const int version) :
+    m_version(version),
+    m_databasePath(databasePath)
+{
+    if (!databasePath.isEmpty()) {
+        // Before opening it, so if it changes while we read it we just load it again
+        const QFileInfo info(databasePath);
+        m_databaseModified = info.lastModified();
+        m_databaseSize = info.size();
+    }
+
+    // Generated at build time from the files in data/, see tools/ItemDatabaseCompiler.cpp
+    const bool opened = databasePath.isEmpty() ? m_database.open() : m_database.open(databasePath);
+    if (!opened) {
+        qWarning() << "Failed to load item database" << databasePath;
+    }
+}
+
+const ItemData *ItemData::loaded(const Table table)
+{
+    // Cheap after the first time, and makes sure only one thread loads it
+    std::call_once(m_tableLoaded[table], [this, table]() {
+        if (!m_database.isOpen()) {
             return;
         }
-        ItemPart part;
-        part.manufacturer = line[0];
-        part.itemType = line[1];
-        part.rarity = line[2];
-        part.balance = line[3];
-        part.category = line[4];
-        part.minParts = line[5].toInt();
-        part.maxParts = line[6].toInt();
-        part.weight = line[7].toFloat();
-        part.partId = line[8];
-        for (QString dep : line[9].split(',', QString::SkipEmptyParts)) {
-            dep = dep.trimmed();
-            if (dep.isEmpty()) {
-                continue;
-            }
-            part.dependencies.append(dep);
-        }
-        for (QString exc : line[10].split(',', QString::SkipEmptyParts)) {
-            exc = exc.trimmed();
-            if (exc.isEmpty()) {
-                continue;
-            }
-            part.excluders.append(exc);
+        switch(table) {
+        case InventorySerials: loadInventorySerials(); break;
+        case EnglishNames: loadEnglishNames(); break;
+        case PartCategories: loadPartCategories(); break;
+        case Parts: loadParts(); break;
+        case Descriptions: loadDescriptions(); break;
+        case ItemInfos: loadItemInfos(); break;
+        case Constraints: loadPartConstraints(); break;
+        case TableCount: break;
         }
-        m_weaponPartTypes[part.partId] = part.category;
-        m_weaponPartCategories.insert(part.balance, part.category);
-        m_weaponParts[part.balance].append(std::move(part));
+    });
+    return this;
+}
+
+ItemData *ItemData::instance()
+{
+    if (t_pinned) {
+        return t_pinned;
+    }
+    ItemData *snapshot = s_current.load(std::memory_order_acquire);
+    if (Q_LIKELY(snapshot)) {
+        return snapshot;
     }
 
-    loadPartsForOther("Grenade");
-    loadPartsForOther("Shield");
-    loadPartsForOther("ClassMod");
-    loadPartsForOther("Artifact");
+    // First time, so the built in one. Not loaded until something is used.
+    QMutexLocker locker(&s_reloadMutex);
+    snapshot = s_current.load(std::memory_order_acquire);
+    if (!snapshot) {
+        snapshots().emplace_back(new ItemData(QString(), 1));
+        snapshot = snapshots().back().get();
+        s_current.store(snapshot, std::memory_order_release);
+    }
+    return snapshot;
+}
 
-    for (const QFileInfo &file : QDir(":/data/descriptions/weapons/").entryInfoList({"*.tsv"})) {
-        loadWeaponPartDescriptions(file.filePath());
+ItemData *ItemData::loadSnapshot(const QString &databasePath)
+{
+    std::unique_ptr<ItemData> snapshot(new ItemData(databasePath, int(snapshots().size()) + 1));
+
+    // Load what decoding needs before anyone can see it, so nobody has to wait for it
+    if (!snapshot->hasDecodingTables()) {
+        qWarning() << "Failed to load item database" << databasePath << ", keeping the current one";
+        return nullptr;
     }
 
-    loadShieldPartDescriptions();
-    loadGrenadePartDescriptions();
-    loadClassModDescriptions("fl4k");
-    loadClassModDescriptions("amara");
-    loadClassModDescriptions("zane");
-    loadItemInfos();
+    snapshots().push_back(std::move(snapshot));
+    ItemData *ret = snapshots().back().get();
+    s_current.store(ret, std::memory_order_release);
+
+    qDebug() << "Loaded item database" << ret->m_version << "from" << (databasePath.isEmpty() ? "the built in one" : databasePath);
+    return ret;
 }
 
-ItemData *ItemData::instance()
+bool ItemData::reload(const QString &databasePath)
 {
-    static ItemData inst;
-    return &inst;
+    QMutexLocker locker(&s_reloadMutex);
+    return loadSnapshot(databasePath) != nullptr;
+}
+
+bool ItemData::reloadIfChanged()
+{
+    const ItemData *snapshot = s_current.load(std::memory_order_acquire);
+    if (!snapshot || snapshot->m_databasePath.isEmpty()) {
+        return false;
+    }
+    const QFileInfo info(snapshot->m_databasePath);
+    if (info.lastModified() == snapshot->m_databaseModified && info.size() == snapshot->m_databaseSize) {
+        return false;
+    }
+
+    QMutexLocker locker(&s_reloadMutex);
+    if (s_current.load(std::memory_order_acquire) != snapshot) {
+        return false; // someone else got there first
+    }
+    return loadSnapshot(snapshot->m_databasePath) != nullptr;
+}
+
+ItemData::Pin::Pin(ItemData *snapshot) :
+    m_previous(t_pinned)
+{
+    t_pinned = snapshot;
+}
+
+ItemData::Pin::~Pin()
+{
+    t_pinned = m_previous;
+}
+
+QFuture<void> ItemData::ready()
+{
+    static QFuture<void> future;
+    static std::once_flag started;
+    std::call_once(started, []() {
+        ItemData *me = instance();
+
+        // Both need the serials, whichever gets there first loads them and
+        // then they can go at the same time
+        QtConcurrent::run([me]() { me->loaded(EnglishNames); });
+
+        // And this one picks up whatever is left, or waits for the others
+        future = QtConcurrent::run([me]() {
+            me->loaded(PartCategories);
+            me->loaded(EnglishNames);
+        });
+    });
+    return future;
+}
+
+void ItemData::warmUp()
+{
+    ready();
+
+    static std::once_flag started;
+    std::call_once(started, []() {
+        ItemData *me = instance();
+
+        // Nobody waits for these, they're loaded when first used if they're not done
+        for (const Table table : { Constraints, Descriptions, ItemInfos }) {
+            QtConcurrent::run([me, table]() { me->loaded(table); });
+        }
+    });
 }
 
 bool ItemData::isValid()
 {
-    ItemData *me = instance();
-    return (!me->m_englishNames.isEmpty() &&
-            !me->m_categoryObjects.isEmpty() &&
-            !me->m_categoryRequiredBits.isEmpty() &&
-            !me->m_itemPartCategories.isEmpty() &&
-            !me->m_weaponParts.isEmpty());
+    return instance()->hasDecodingTables();
+}
+
+bool ItemData::hasDecodingTables()
+{
+    // Only what is needed to decode items, the rest is loaded when it is needed
+    return (m_database.isOpen() &&
+            !loaded(EnglishNames)->m_englishNames.isEmpty() &&
+            !loaded(InventorySerials)->m_serialCategories.isEmpty() &&
+            !loaded(PartCategories)->m_itemPartCategories.isEmpty());
 }
 
-QString ItemData::getItemAsset(const QString &category, const int index)
+// The ones used when decoding items only use const lookups, so they are safe
+// to call from several threads at once
+
+CategoryHandle ItemData::categoryHandle(const QString &category)
 {
-    ItemData *me = instance();
+    instance()->loaded(InventorySerials); // so they're all added
+    return findCategoryHandle(category);
+}
+
+const QString &ItemData::categoryName(const CategoryHandle category)
+{
+    const ItemData *me = instance()->loaded(InventorySerials);
+    if (category < 0 || category >= me->m_serialCategories.count()) {
+        return nullString;
+    }
+    return me->m_serialCategories[category].name;
+}
+
+StringId ItemData::getItemAsset(const CategoryHandle category, const int index)
+{
+    const ItemData *me = instance()->loaded(InventorySerials);
     if (index < 0) {
         qWarning() << "Invalid item index" << index;
-        return {};
+        return StringPool::null;
     }
-    if (!me->m_categoryObjects.contains(category)) {
+    if (category < 0 || category >= me->m_serialCategories.count()) {
         qWarning() << "Invalid category" << category;
-        return {};
+        return StringPool::null;
     }
 
-    if (index >= me->m_categoryObjects[category].count()) {
-        qWarning() << "Asset index" << index << "out of range, max:" << me->m_categoryObjects[category].count();
-        return {};
+    const QVector<StringId> &objects = me->m_serialCategories[category].objects;
+    if (index >= objects.count()) {
+        qWarning() << "Asset index" << index << "out of range, max:" << objects.count();
+        return StringPool::null;
     }
-    return me->m_categoryObjects[category][index];
-
+    return objects[index];
 }
 
-int ItemData::requiredBits(const QString &category, const int requiredVersion)
+int ItemData::requiredBits(const CategoryHandle category, const int requiredVersion)
 {
-    ItemData *me = instance();
-    if (!me->m_categoryRequiredBits.contains(category)) {
+    const ItemData *me = instance()->loaded(InventorySerials);
+    if (category < 0 || category >= me->m_serialCategories.count()) {
         qWarning() << "Invalid category" << category;
         return -1;
     }
 
-    const QVector<QPair<int, int>> &versions = me->m_categoryRequiredBits[category];
-
-    int bits = versions.first().second;
-    for (const QPair<int, int> &version : versions) {
-        const int versionNumber = version.first;
-        const int currentBits = version.second;
-        if (versionNumber > requiredVersion) {
-            return currentBits;
-        }
-
-        // I don't understand this, but CJ does so I just follow him blindly
-        // The logic seems either flipped or unnecessary
-        bits = currentBits;
+    const QVector<int> &bitsForVersion = me->m_serialCategories[category].bitsForVersion;
+    if (bitsForVersion.isEmpty()) {
+        return -1;
     }
-
-    return bits;
-
+    return bitsForVersion[qBound(0, requiredVersion, bitsForVersion.count() - 1)];
 }
 
 QString ItemData::englishName(const QString &itemName)
 {
-    ItemData *me = instance();
-    const QString lowerCase = itemName.toLower();
-    if (!me->m_englishNames.contains(lowerCase)) {
+    const ItemData *me = instance()->loaded(EnglishNames);
+    QHash<StringId, StringId>::const_iterator it = me->m_englishNames.constFind(StringPool::find(itemName));
+    if (it == me->m_englishNames.constEnd()) {
+        it = me->m_englishNames.constFind(StringPool::find(itemName.toLower()));
+    }
+    if (it == me->m_englishNames.constEnd()) {
         return itemName;
     }
-    return me->m_englishNames[lowerCase].toString();
+    return StringPool::string(*it);
 }
 
 QString ItemData::partCategory(const QString &objectName)
 {
-    ItemData *me = instance();
-    const QString lowerCase = objectName.toLower();
-    if (!me->m_itemPartCategories.contains(lowerCase)) {
+    const ItemData *me = instance()->loaded(PartCategories);
+    QHash<StringId, CategoryHandle>::const_iterator it = me->m_itemPartCategories.constFind(StringPool::find(objectName));
+    if (it == me->m_itemPartCategories.constEnd()) {
+        it = me->m_itemPartCategories.constFind(StringPool::find(objectName.toLower()));
+    }
+    if (it == me->m_itemPartCategories.constEnd()) {
         qWarning() << objectName << "not in part category db";
+        return {};
+    }
+    return categoryName(*it);
+}
+
+const QString &ItemData::englishName(const StringId itemName)
+{
+    const ItemData *me = instance()->loaded(EnglishNames);
+    QHash<StringId, StringId>::const_iterator it = me->m_englishNames.constFind(itemName);
+    if (it == me->m_englishNames.constEnd()) {
+        it = me->m_englishNames.constFind(StringPool::find(StringPool::string(itemName).toLower()));
+    }
+    if (it == me->m_englishNames.constEnd()) {
+        return StringPool::string(itemName);
     }
-    return me->m_itemPartCategories[lowerCase].toString();
+    return StringPool::string(*it);
+}
+
+CategoryHandle ItemData::partCategory(const StringId objectName)
+{
+    const ItemData *me = instance()->loaded(PartCategories);
+    QHash<StringId, CategoryHandle>::const_iterator it = me->m_itemPartCategories.constFind(objectName);
+    if (it == me->m_itemPartCategories.constEnd()) {
+        it = me->m_itemPartCategories.constFind(StringPool::find(StringPool::string(objectName).toLower()));
+    }
+    if (it == me->m_itemPartCategories.constEnd()) {
+        qWarning() << StringPool::string(objectName) << "not in part category db";
+        return -1;
+    }
+    return *it;
+}
+
+StringId ItemData::objectShortName(const StringId objectName)
+{
+    const ItemData *me = instance()->loaded(InventorySerials);
+    return me->m_objectShortNames.value(objectName, StringPool::null);
 }
 
 const QVector<ItemPart> &ItemData::weaponParts(const QString &balance)
 {
-    ItemData *me = instance();
-    if (!me->m_weaponParts.contains(balance)) {
+    const ItemData *me = instance()->loaded(Parts);
+    QHash<QString, QVector<ItemPart>>::const_iterator it = me->m_weaponParts.constFind(balance);
+    if (it == me->m_weaponParts.constEnd()) {
         return nullWeaponParts;
     }
 
-    return me->m_weaponParts[balance];
+    return *it;
+}
+
+QStringList ItemData::categoriesForWeapon(const QString &balance)
+{
+    const ItemData *me = instance()->loaded(Parts);
+    QStringList ret;
+    for (const StringId category : me->m_weaponPartCategories.values(balance)) {
+        ret.append(StringPool::string(category));
+    }
+    return ret;
+}
+
+const QString &ItemData::weaponPartType(const QString &id)
+{
+    const ItemData *me = instance()->loaded(Parts);
+    return StringPool::string(me->m_weaponPartTypes.value(StringPool::find(id), StringPool::null));
+}
+
+QStringList ItemData::balancesWithParts()
+{
+    const ItemData *me = instance()->loaded(Parts);
+    QStringList ret = me->m_weaponParts.keys();
+    ret.sort();
+    return ret;
 }
 
-int ItemData::partIndex(const QString &category, const QString &id)
+const PartConstraints &ItemData::partConstraints(const QString &balance)
 {
-    ItemData *me = instance();
-    if (!me->m_categoryObjects.contains(category)) {
-        qWarning() << "Invalid category requested" << category << "for" << id;
+    const ItemData *me = instance()->loaded(Constraints);
+    QHash<QString, PartConstraints>::const_iterator it = me->m_partConstraints.constFind(balance);
+    if (it == me->m_partConstraints.constEnd()) {
+        return nullPartConstraints;
+    }
+    return *it;
+}
+
+int ItemData::partIndex(const CategoryHandle category, const QString &id)
+{
+    // If it has never been interned it isn't in any of the lists, and null is never in them
+    return partIndex(category, StringPool::find(id));
+}
+
+int ItemData::partIndex(const CategoryHandle category, const StringId id)
+{
+    const ItemData *me = instance()->loaded(InventorySerials);
+    if (category < 0 || category >= me->m_serialCategories.count()) {
+        qWarning() << "Invalid category requested" << category << "for" << StringPool::string(id);
         return -1;
     }
 
-    return me->m_categoryObjects[category].indexOf(id);
+    return me->m_serialCategories[category].objectIndexes.value(id, -1);
+}
+
+const ItemDescription &ItemData::itemDescription(const QString &id)
+{
+    const ItemData *me = instance()->loaded(Descriptions);
+    QHash<QString, ItemDescription>::const_iterator it = me->m_itemDescriptions.constFind(id);
+    if (it == me->m_itemDescriptions.constEnd()) {
+        return nullDescription;
+    }
+    return *it;
+}
+
+const ItemInfo &ItemData::itemInfo(const QString &id)
+{
+    const ItemData *me = instance()->loaded(ItemInfos);
+    QHash<QString, ItemInfo>::const_iterator it = me->m_itemInfos.constFind(id);
+    if (it == me->m_itemInfos.constEnd()) {
+        return nullItemInfo;
+    }
+    return *it;
+}
+
+const QString &ItemData::objectForShortName(const QString &shortName)
+{
+    const ItemData *me = instance()->loaded(InventorySerials);
+    QHash<QString, StringId>::const_iterator it = me->m_shortNameToObject.constFind(shortName);
+    if (it == me->m_shortNameToObject.constEnd()) {
+        return nullString;
+    }
+    return StringPool::string(*it);
 }
 
 InventoryItem::Aspect ItemData::createInventoryItemPart(const InventoryItem &inventoryItem, const QString &objectName)
 {
-    ItemData *me = instance();
     InventoryItem::Aspect part;
-    part.index = me->partIndex(inventoryItem.partsCategory, objectName);
+    part.index = partIndex(inventoryItem.partsCategory, objectName);
     if (part.index <= 0) {
         qWarning() << "Invalid object name" << objectName;
         return {};
@@ -195,246 +442,201 @@ InventoryItem::Aspect ItemData::createInventoryItemPart(const InventoryItem &inv
     return part;
 }
 
-void ItemData::loadPartsForOther(const QString &type)
+// Both of these also add the balances from the serial database as they are,
+// so decoding doesn't have to lower case anything to look them up. Only
+// lower cases each of them once here.
+void ItemData::loadEnglishNames()
 {
-    QFile grenadeModsFile(":/data/" + type.toLower() + "-parts.tsv");
-    grenadeModsFile.open(QIODevice::ReadOnly);
-    grenadeModsFile.readLine(); // Skip header
-    while (!grenadeModsFile.atEnd()) {
-        QStringList line = QString::fromUtf8(grenadeModsFile.readLine()).split('\t');
-        if (line.length() != 10) {
-            qWarning() << "Invalid line in grenade mods file" << line;
-            return;
-        }
-        ItemPart part;
-        part.manufacturer = line[0];
-        part.itemType = type;
-        part.rarity = line[1];
-        part.balance = line[2];
-        part.category = line[3];
-        part.minParts = line[4].toInt();
-        part.maxParts = line[5].toInt();
-        part.weight = line[6].toFloat();
-        part.partId = line[7];
-        for (QString dep : line[8].split(',')) {
-            dep = dep.trimmed();
-            if (dep.isEmpty()) {
-                continue;
-            }
-            part.dependencies.append(dep);
-        }
-        for (QString exc : line[9].split(',')) {
-            exc = exc.trimmed();
-            if (exc.isEmpty()) {
-                continue;
-            }
-            part.excluders.append(exc);
+    int count = 0;
+    const itemdb::NamePair *names = m_database.records<itemdb::NamePair>(itemdb::Section::EnglishNames, &count);
+    const ItemData *serials = loaded(InventorySerials);
+    const CategoryHandle balances = findCategoryHandle(QStringLiteral("InventoryBalanceData"));
+    if (balances >= 0 && balances < serials->m_serialCategories.count()) {
+        m_englishNames.reserve(count + serials->m_serialCategories[balances].objects.count());
+    }
+
+    for (int i=0; i<count; i++) {
+        m_englishNames.insert(StringPool::intern(m_database.string(names[i].key)), StringPool::intern(m_database.string(names[i].value)));
+    }
+
+    if (balances < 0 || balances >= serials->m_serialCategories.count()) {
+        qWarning() << "No balances in the serial database";
+        return;
+    }
+    for (const StringId balance : serials->m_serialCategories[balances].objects) {
+        const StringId shortName = serials->m_objectShortNames.value(balance);
+        const QHash<StringId, StringId>::const_iterator it = m_englishNames.constFind(StringPool::find(StringPool::string(shortName).toLower()));
+        if (it != m_englishNames.constEnd()) {
+            m_englishNames.insert(shortName, *it);
         }
-        m_weaponPartTypes[part.partId] = part.category;
-        m_weaponPartCategories.insert(part.balance, part.category);
-        m_weaponParts[part.balance].append(std::move(part));
     }
 }
 
-void ItemData::loadWeaponPartDescriptions(const QString &filename)
+void ItemData::loadPartCategories()
 {
-    QFile file(filename);
-    file.open(QIODevice::ReadOnly);
-    for (const QByteArray &line : file.readAll().split('\n')) {
-        if (line.isEmpty() || line.startsWith('#')) {
-            continue;
-        }
-        const QList<QByteArray> values = line.split('\t');
-        if (values.count() != 5) {
-            qWarning() << "Invalid number of values in" << filename;
-            return;
-        }
-        const QString id = values[0].split('.').last();
-        if (m_itemDescriptions.contains(id)) {
-            qWarning() << "Duplicate description for" << id;
-            continue;
-        }
-        if (id.isEmpty()) {
-            qWarning() << "Empty id" << values << "in" << filename;
+    int count = 0;
+    const itemdb::NamePair *categories = m_database.records<itemdb::NamePair>(itemdb::Section::PartCategories, &count);
+    const ItemData *serials = loaded(InventorySerials);
+    const CategoryHandle balances = findCategoryHandle(QStringLiteral("InventoryBalanceData"));
+    if (balances >= 0 && balances < serials->m_serialCategories.count()) {
+        m_itemPartCategories.reserve(count + serials->m_serialCategories[balances].objects.count());
+    }
+
+    for (int i=0; i<count; i++) {
+        const QString categoryName = m_database.string(categories[i].value);
+        const CategoryHandle category = findCategoryHandle(categoryName);
+        if (category < 0 || category >= serials->m_serialCategories.count() || serials->m_serialCategories[category].name.isEmpty()) {
+            qWarning() << "Unknown part category" << categoryName << "for" << m_database.string(categories[i].key);
             continue;
         }
-        if (!m_weaponPartTypes.contains(id)) {
-//            qWarning() << "Unknown part" << id;
+        m_itemPartCategories.insert(StringPool::intern(m_database.string(categories[i].key)), category);
+    }
+
+    if (balances < 0 || balances >= serials->m_serialCategories.count()) {
+        qWarning() << "No balances in the serial database";
+        return;
+    }
+    for (const StringId balance : serials->m_serialCategories[balances].objects) {
+        const QHash<StringId, CategoryHandle>::const_iterator it = m_itemPartCategories.constFind(StringPool::find(StringPool::string(balance).toLower()));
+        if (it != m_itemPartCategories.constEnd()) {
+            m_itemPartCategories.insert(balance, *it);
         }
-        ItemDescription description;
-        description.positives = values[1];
-        description.negatives = values[2];
-        description.effects = values[3];
-        description.naming = values[4];
-        m_itemDescriptions[id] = std::move(description);
     }
 }
 
-void ItemData::loadShieldPartDescriptions()
+void ItemData::loadParts()
 {
-    QFile file(":/data/descriptions/shields.tsv");
-    file.open(QIODevice::ReadOnly);
-    for (const QByteArray &line : file.readAll().split('\n')) {
-        if (line.isEmpty() || line.startsWith('#')) {
-            continue;
-        }
-        const QList<QByteArray> values = line.split('\t');
-        if (values.count() != 3) {
-            qWarning() << "Invalid number of values in shields desc file";
-            return;
-        }
-        const QString id = values[0].split('.').last();
-        if (m_itemDescriptions.contains(id)) {
-            qWarning() << "Duplicate description for" << id;
-            continue;
-        }
-        if (!m_weaponPartTypes.contains(id)) {
-            qWarning() << "Unknown part" << id;
-        }
-        ItemDescription description;
-        description.effects = values[1];
-        description.naming = values[2]; // meh, close enough
-        m_itemDescriptions[id] = std::move(description);
+    int count = 0;
+    const itemdb::Part *parts = m_database.records<itemdb::Part>(itemdb::Section::Parts, &count);
+    for (int i=0; i<count; i++) {
+        const itemdb::Part &dbPart = parts[i];
+
+        ItemPart part;
+        part.manufacturer = StringPool::intern(m_database.string(dbPart.manufacturer));
+        part.itemType = StringPool::intern(m_database.string(dbPart.itemType));
+        part.rarity = StringPool::intern(m_database.string(dbPart.rarity));
+        part.balance = StringPool::intern(m_database.string(dbPart.balance));
+        part.category = StringPool::intern(m_database.string(dbPart.category));
+        part.minParts = dbPart.minParts;
+        part.maxParts = dbPart.maxParts;
+        part.weight = dbPart.weight;
+        part.partId = StringPool::intern(m_database.string(dbPart.partId));
+        part.dependencies = internAll(m_database.stringList(itemdb::Section::PartLists, dbPart.firstDependency, dbPart.dependencyCount));
+        part.excluders = internAll(m_database.stringList(itemdb::Section::PartLists, dbPart.firstExcluder, dbPart.excluderCount));
+
+        const QString balance = m_database.string(dbPart.balance);
+        m_weaponPartTypes[part.partId] = part.category;
+        m_weaponPartCategories.insert(balance, part.category);
+        m_weaponParts[balance].append(std::move(part));
     }
 }
 
-void ItemData::loadGrenadePartDescriptions()
+void ItemData::loadPartConstraints()
 {
-    QFile file(":/data/descriptions/grenades.tsv");
-    if (!file.open(QIODevice::ReadOnly)) {
-        qWarning() << "Failed to load grenades file";
-        return;
-    }
-    for (const QByteArray &line : file.readAll().split('\n')) {
-        if (line.isEmpty() || line.startsWith('#')) {
-            continue;
-        }
-        const QList<QByteArray> values = line.split('\t');
-        if (values.count() != 3) {
-            qWarning() << "Invalid number of values in grenades desc file";
-            return;
-        }
-        const QString id = values[1].split('.').last();
-        if (m_itemDescriptions.contains(id)) {
-            qWarning() << "Duplicate description for" << id;
-            continue;
-        }
-        if (!m_weaponPartTypes.contains(id)) {
-            qWarning() << "Unknown part" << id;
-        }
-        ItemDescription description;
-        description.effects = values[2];
-        description.naming = values[0]; // meh, close enough
-        m_itemDescriptions[id] = std::move(description);
+    loaded(Parts);
+    m_partConstraints.reserve(m_weaponParts.count());
+    for (QHash<QString, QVector<ItemPart>>::const_iterator it = m_weaponParts.constBegin(); it != m_weaponParts.constEnd(); ++it) {
+        m_partConstraints.insert(it.key(), PartConstraints(it.value()));
     }
 }
 
-void ItemData::loadClassModDescriptions(const QString &characterClass)
+void ItemData::loadDescriptions()
 {
-    QFile file(":/data/descriptions/com-" + characterClass + ".tsv");
-    if (!file.open(QIODevice::ReadOnly)) {
-        qWarning() << "Failed to open" + characterClass + "com file";
-        return;
-    }
-    for (const QByteArray &line : file.readAll().split('\n')) {
-        if (line.isEmpty() || line.startsWith('#')) {
-            continue;
-        }
-        QList<QByteArray> values = line.split('\t');
-        if (values.count() > 2) {
-            values.takeFirst(); // meh, can't be bothered to fix the files
-//            qWarning() << "Invalid number of values in" << characterClass << "com desc file";
-//            qDebug() << values;
-//            return;
-        }
-        const QString id = values[0].split('.').last();
-        if (m_itemDescriptions.contains(id)) {
-            qWarning() << "Duplicate description for" << id;
-            continue;
-        }
-        if (!m_weaponPartTypes.contains(id)) {
-            qWarning() << "Unknown part" << id;
-        }
+    int count = 0;
+    const itemdb::Description *descriptions = m_database.records<itemdb::Description>(itemdb::Section::Descriptions, &count);
+    m_itemDescriptions.reserve(count);
+    for (int i=0; i<count; i++) {
         ItemDescription description;
-        description.effects = values[1];
-//        description.naming = values[0]; // meh, close enough
-        m_itemDescriptions[id] = std::move(description);
+        description.positives = m_database.string(descriptions[i].positives);
+        description.negatives = m_database.string(descriptions[i].negatives);
+        description.effects = m_database.string(descriptions[i].effects);
+        description.naming = m_database.string(descriptions[i].naming);
+        m_itemDescriptions[m_database.string(descriptions[i].id)] = std::move(description);
     }
 }
 
 void ItemData::loadItemInfos()
 {
-    QFile namesFile(":/data/item-data.json");
-    namesFile.open(QIODevice::ReadOnly);
-    const QJsonObject rootObject =  QJsonDocument::fromJson(namesFile.readAll()).object();
-
-    for (const QJsonValue &val : rootObject) {
-        const QJsonObject obj = val.toObject();
-        const QString assetName = obj["AssetName"].toString();
-        if (assetName.isEmpty()) {
-            qWarning() << "Invalid object" << obj;
-            continue;
-        }
+    int count = 0;
+    const itemdb::ItemInfo *infos = m_database.records<itemdb::ItemInfo>(itemdb::Section::ItemInfos, &count);
+    m_itemInfos.reserve(count);
+    for (int i=0; i<count; i++) {
+        const itemdb::ItemInfo &dbInfo = infos[i];
 
         ItemInfo info;
-
-        info.inventoryName = obj["InventoryName"].toString();
-        info.inventoryNameLocationKey = obj["InventoryName_LocKey"].toString();
-
-        info.inventoryCategoryHash = obj["InventoryCategoryHash"].toInt();
-
-        info.inventorySize = obj["SizeInInventory"].toDouble();
-        info.usesInventoryScore = obj["UsesInventoryScore"].toBool();
-
-
-        info.monetaryValue = obj["MonetaryValue"].toInt();
-        info.baseMonetaryValueModifier = obj["BaseMonetaryValueModifier"].toDouble();
-
-        const QString droppability = obj["Droppability"].toString();
-        if (droppability == QLatin1String("EPD_CanDropAndSell")) {
-            info.canDropOrSell = true;
-        } else if (droppability == QLatin1String("EPD_NoDropOrSell")) {
-            info.canDropOrSell = true;
-        } else {
-            qWarning() << "Unknown droppability" << droppability;
-        }
-
-
-//        qDebug() << "Adding" << assetName << info.inventoryName;
-        m_itemInfos[assetName] = std::move(info); // compilers probably figure it out themselves, but meh
+        info.inventoryName = m_database.string(dbInfo.inventoryName);
+        info.inventoryNameLocationKey = m_database.string(dbInfo.inventoryNameLocationKey);
+        info.inventoryCategoryHash = dbInfo.inventoryCategoryHash;
+        info.inventorySize = dbInfo.inventorySize;
+        info.usesInventoryScore = dbInfo.usesInventoryScore;
+        info.monetaryValue = dbInfo.monetaryValue;
+        info.baseMonetaryValueModifier = dbInfo.baseMonetaryValueModifier;
+        info.canDropOrSell = dbInfo.canDropOrSell;
+
+        m_itemInfos[m_database.string(dbInfo.assetName)] = std::move(info);
     }
     qDebug() << "Loaded" << m_itemInfos.count() << "item infos";
-
 }
 
 void ItemData::loadInventorySerials()
 {
-    QFile dbFile(":/data/inventory-serials.json");
-    dbFile.open(QIODevice::ReadOnly);
-    const QJsonObject serialsDb = QJsonDocument::fromJson(dbFile.readAll()).object();
-    for (const QString &category : serialsDb.keys()) {
-        const QJsonObject &categoryObject = serialsDb[category].toObject();
-        const QJsonArray assets = categoryObject["assets"].toArray();
-        for (const QJsonValue val : assets) {
-            const QString objectName = val.toString();
-            m_categoryObjects[category].append(objectName);
-            m_shortNameToObject[objectName.split('.').last()] = objectName;
-        }
+    int categoryCount = 0;
+    const itemdb::Category *categories = m_database.records<itemdb::Category>(itemdb::Section::Categories, &categoryCount);
+    int versionCount = 0;
+    const itemdb::CategoryVersion *versions = m_database.records<itemdb::CategoryVersion>(itemdb::Section::CategoryVersions, &versionCount);
+
+    m_serialCategories.reserve(categoryCount);
+    for (int i=0; i<categoryCount; i++) {
+        const itemdb::Category &category = categories[i];
+
+        SerialCategory serialCategory;
+        serialCategory.name = m_database.string(category.name);
+
+        const QStringList assets = m_database.stringList(itemdb::Section::CategoryAssets, category.firstAsset, category.assetCount);
+        serialCategory.objects.reserve(assets.count());
+        serialCategory.objectIndexes.reserve(assets.count() * 2);
+        for (const QString &objectName : assets) {
+            const QString shortName = objectName.split('.').last();
+            const StringId objectId = StringPool::intern(objectName);
+            const StringId shortNameId = StringPool::intern(shortName);
+            m_shortNameToObject[shortName] = objectId;
+            m_objectShortNames.insert(objectId, shortNameId);
+
+            // Both, so the UI can use the short names directly. If something
+            // is in there twice the first one wins, like indexOf() did.
+            const int index = serialCategory.objects.count();
+            if (!serialCategory.objectIndexes.contains(objectId)) {
+                serialCategory.objectIndexes.insert(objectId, index);
+            }
+            if (!serialCategory.objectIndexes.contains(shortNameId)) {
+                serialCategory.objectIndexes.insert(shortNameId, index);
+            }
 
-        const QJsonArray versions = categoryObject["versions"].toArray();
+            serialCategory.objects.append(objectId);
+        }
 
-        QVector<QPair<int, int>> versionsVector;
-        for (const QJsonValue &val : versions) {
-            QJsonObject version = val.toObject();
-            if (!version.contains("bits") || !version.contains("version")) {
-                qWarning() << "Invalid version in" << category;
-                continue;
+        if (quint64(category.firstVersion) + category.versionCount > quint64(versionCount)) {
+            qWarning() << "Invalid versions for" << serialCategory.name;
+        } else if (category.versionCount > 0) {
+            // The bits for an item version are from the first entry with a
+            // higher version, or the last one if there are none. I don't
+            // understand this, but CJ does so I just follow him blindly.
+            const itemdb::CategoryVersion *first = versions + category.firstVersion;
+            const itemdb::CategoryVersion *last = first + category.versionCount - 1;
+            serialCategory.bitsForVersion.resize(int(last->version) + 1);
+            const itemdb::CategoryVersion *current = first;
+            for (int version=0; version<serialCategory.bitsForVersion.count(); version++) {
+                while (current != last && int(current->version) <= version) {
+                    current++;
+                }
+                serialCategory.bitsForVersion[version] = int(current->version) > version ? int(current->bits) : int(last->bits);
             }
-            const int bits = version["bits"].toInt();
-            const int versionNumber = version["version"].toInt();
-            versionsVector.append({versionNumber, bits});
         }
 
-        m_categoryRequiredBits[category] = std::move(versionsVector);
+        const CategoryHandle handle = addCategoryHandle(serialCategory.name);
+        if (handle >= m_serialCategories.count()) {
+            m_serialCategories.resize(handle + 1);
+        }
+        m_serialCategories[handle] = std::move(serialCategory);
     }
 }
@@ -2,27 +2,34 @@
 #define ITEMDATA_H
 
 #include "InventoryItem.h"
+#include "ItemDatabase.h"
+#include "PartConstraints.h"
+#include "StringPool.h"
 
-#include <QJsonObject>
 #include <QStringList>
 #include <QMap>
 #include <QHash>
 #include <QVector>
 #include <QPair>
+#include <QFuture>
+#include <QDateTime>
 
-// Could use an enum, but memory is cheap and I'm lazy
+#include <mutex>
+
+// There's ~20k of these, so the strings are interned. Use
+// StringPool::string() to show them.
 struct ItemPart {
-    QString manufacturer;
-    QString itemType;
-    QString rarity;
-    QString balance;
-    QString category;
+    StringId manufacturer = StringPool::null;
+    StringId itemType = StringPool::null;
+    StringId rarity = StringPool::null;
+    StringId balance = StringPool::null;
+    StringId category = StringPool::null;
     int minParts = 0;
     int maxParts = 0;
     float weight = 0.f;
-    QString partId;
-    QStringList dependencies;
-    QStringList excluders;
+    StringId partId = StringPool::null;
+    QVector<StringId> dependencies;
+    QVector<StringId> excluders;
 };
 
 struct ItemDescription {
@@ -47,59 +54,167 @@ struct ItemInfo {
     bool canDropOrSell = false;
 };
 
+// All the static functions use a snapshot of the data, which doesn't change
+// once it is loaded so any number of threads can use it without locking.
+// reload() loads a new one and swaps it in atomically, the old ones are kept
+// around since the interned strings and whoever is still using them point
+// into them.
 class ItemData
 {
 public:
+    // The one pinned by this thread, or the current one
     static ItemData *instance();
 
     static bool isValid();
 
-    static QString getItemAsset(const QString &category, const int index);
-    static int requiredBits(const QString &category, const int requiredVersion);
-
+    // Loads a database made with ItemDatabaseCompiler (or the built in one if
+    // the path is empty) and starts using it. Keeps using the current one and
+    // returns false if it can't be loaded.
+    static bool reload(const QString &databasePath = {});
+
+    // If the current database is loaded from a file and the file has changed
+    // since, reloads it. Cheap enough to call every now and then.
+    static bool reloadIfChanged();
+
+    // Increases with every reload
+    static int version() { return instance()->m_version; }
+
+    // Keeps this thread on the same snapshot while it exists, so something
+    // isn't decoded half with the old data and half with the new
+    class Pin {
+    public:
+        Pin() : Pin(instance()) {}
+        explicit Pin(ItemData *snapshot);
+        ~Pin();
+
+        Pin(const Pin &) = delete;
+        Pin &operator=(const Pin &) = delete;
+
+    private:
+        ItemData *m_previous;
+    };
+
+    // Starts loading what is needed to decode items in the background, if it
+    // isn't already, finished when they're loaded
+    static QFuture<void> ready();
+
+    // Same as ready(), and also loads everything else (for the GUI) in the
+    // background in parallel
+    static void warmUp();
+
+    // The serial categories ("InventoryBalanceData" etc.) are looked up
+    // once, the rest of the lookups just index arrays with the handle.
+    // -1 if there's no such category. The handles stay the same across
+    // reloads.
+    static CategoryHandle categoryHandle(const QString &category);
+    static const QString &categoryName(const CategoryHandle category);
+
+    // The asset path, or StringPool::null if it is invalid
+    static StringId getItemAsset(const CategoryHandle category, const int index);
+    static int requiredBits(const CategoryHandle category, const int requiredVersion);
+
+    // Not case sensitive, the name itself if we don't have one
     static QString englishName(const QString &itemName);
     static QString partCategory(const QString &objectName);
 
+    // Don't allocate anything for the balances from the serial database,
+    // which is what decoding uses. Anything else is lower cased first.
+    static const QString &englishName(const StringId itemName);
+    static CategoryHandle partCategory(const StringId objectName);
+
+    // The last part of the asset path, Balance_Foo for /Game/.../Balance_Foo.Balance_Foo
+    static StringId objectShortName(const StringId objectName);
+
     static const QVector<ItemPart> &weaponParts(const QString &balance);
-    static QStringList categoriesForWeapon(const QString &balance) { return instance()->m_weaponPartCategories.values(balance); }
-    static QString weaponPartType(const QString &id) { return instance()->m_weaponPartTypes[id]; }
+    static QStringList categoriesForWeapon(const QString &balance);
+    static const QString &weaponPartType(const QString &id);
 
-    static int partIndex(const QString &category, const QString &id);
+    // All the balances we have parts for, what weaponParts() etc. takes
+    static QStringList balancesWithParts();
 
-    static const ItemDescription &itemDescription(const QString &id) { return instance()->m_itemDescriptions[id]; }
-    static const ItemInfo &itemInfo(const QString &id) { return instance()->m_itemInfos[id]; }
-    static bool hasItemInfo(const QString &id) { return instance()->m_itemInfos.contains(id); } // inefficient lol
+    // Built from weaponParts() the first time, empty if we don't know the balance
+    static const PartConstraints &partConstraints(const QString &balance);
 
-    static const QString &objectForShortName(const QString &shortName) { return instance()->m_shortNameToObject[shortName]; }
+    // Index in the category of the asset, takes either the full asset path
+    // or the short name (the last part of it). -1 if it isn't there.
+    static int partIndex(const CategoryHandle category, const QString &id);
+    static int partIndex(const CategoryHandle category, const StringId id);
+
+    static const ItemDescription &itemDescription(const QString &id);
+    static const ItemInfo &itemInfo(const QString &id);
+    static bool hasItemInfo(const QString &id) { return instance()->loaded(ItemInfos)->m_itemInfos.contains(id); } // inefficient lol
+
+    static const QString &objectForShortName(const QString &shortName);
 
     static InventoryItem::Aspect createInventoryItemPart(const InventoryItem &inventoryItem, const QString &objectName);
 
 //    static bool hasItemPart(const QString &id) { return instance()->m_}
 
 private:
-    ItemData();
-
-    void loadPartsForOther(const QString &type);
-    void loadWeaponPartDescriptions(const QString &filename);
-    void loadShieldPartDescriptions();
-    void loadGrenadePartDescriptions();
-    void loadClassModDescriptions(const QString &characterClass);
+    ItemData(const QString &databasePath, const int version);
+
+    // Needs s_reloadMutex
+    static ItemData *loadSnapshot(const QString &databasePath);
+    bool hasDecodingTables();
+
+    // The tables are only loaded from the database the first time they're
+    // used, so decoding items doesn't pay for all the descriptions etc.
+    enum Table {
+        InventorySerials,
+        EnglishNames,
+        PartCategories,
+        Parts,
+        Descriptions,
+        ItemInfos,
+        Constraints,
+        TableCount
+    };
+    const ItemData *loaded(const Table table);
+
+    void loadEnglishNames();
+    void loadPartCategories();
+    void loadParts();
+    void loadDescriptions();
     void loadItemInfos();
+    void loadPartConstraints();
     void loadInventorySerials();
 
     static const QVector<ItemPart> nullWeaponParts; // so we always can return references
-
-    QJsonObject m_englishNames;
-    QJsonObject m_itemPartCategories;
+    static const ItemDescription nullDescription;
+    static const ItemInfo nullItemInfo;
+    static const PartConstraints nullPartConstraints;
+    static const QString nullString;
+
+    // All the strings point into this, so it needs to be first
+    ItemDatabase m_database;
+    std::once_flag m_tableLoaded[TableCount];
+
+    const int m_version;
+    const QString m_databasePath; // empty for the built in one
+    QDateTime m_databaseModified;
+    qint64 m_databaseSize = 0;
+
+    // Keys are both the lower case names from the database, and the
+    // balances as they are in the serial database, so we don't need to
+    // lower case those when decoding.
+    QHash<StringId, StringId> m_englishNames;
+    QHash<StringId, CategoryHandle> m_itemPartCategories;
     QHash<QString, QVector<ItemPart>> m_weaponParts;
-    QHash<QString, QString> m_weaponPartTypes;
-    QMultiMap<QString, QString> m_weaponPartCategories;
+    QHash<StringId, StringId> m_weaponPartTypes;
+    QMultiMap<QString, StringId> m_weaponPartCategories;
+    QHash<QString, PartConstraints> m_partConstraints;
     QHash<QString, ItemDescription> m_itemDescriptions;
     QHash<QString, ItemInfo> m_itemInfos;
 
-    QHash<QString, QStringList> m_categoryObjects;
-    QHash<QString, QVector<QPair<int, int>>> m_categoryRequiredBits;
-    QHash<QString, QString> m_shortNameToObject;
+    struct SerialCategory {
+        QString name;
+        QVector<StringId> objects;
+        QHash<StringId, int> objectIndexes; // reverse of objects
+        QVector<int> bitsForVersion; // index is the item version, the last one is used for anything newer
+    };
+    QVector<SerialCategory> m_serialCategories; // index is the CategoryHandle, empty ones aren't in this database
+    QHash<QString, StringId> m_shortNameToObject;
+    QHash<StringId, StringId> m_objectShortNames;
 };
 
 #endif // ITEMDATA_H
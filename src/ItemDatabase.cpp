@@ -0,0 +1,101 @@
+#include "ItemDatabase.h"
+
+#include <QResource>
+#include <QFile>
+#include <QDebug>
+
+#include <cstring>
+
+static_assert(Q_BYTE_ORDER == Q_LITTLE_ENDIAN, "The database is used as is, so we need to be little endian");
+
+bool ItemDatabase::open(const QString &path)
+{
+    if (!path.startsWith(':')) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qWarning() << "Failed to open item database" << path << file.errorString();
+            return false;
+        }
+        m_alignedCopy = file.readAll(); // QByteArray data is at least 8 byte aligned
+        return openData(m_alignedCopy.constData(), m_alignedCopy.size());
+    }
+
+    QResource resource(path);
+    if (!resource.isValid()) {
+        qWarning() << "Item database missing:" << path;
+        return false;
+    }
+#if QT_VERSION >= QT_VERSION_CHECK(5, 13, 0)
+    if (resource.compressionAlgorithm() != QResource::NoCompression) {
+#else
+    if (resource.isCompressed()) {
+#endif
+        qWarning() << "Item database is compressed, needs to be built with rcc -no-compress";
+        return false;
+    }
+
+    const char *data = reinterpret_cast<const char*>(resource.data());
+    const qint64 size = resource.size();
+
+    // rcc doesn't promise any alignment, and we use the structs in place
+    if (quintptr(data) % alignof(uint64_t) != 0) {
+        qDebug() << "Item database not aligned, copying";
+        m_alignedCopy = QByteArray(data, int(size));
+        data = m_alignedCopy.constData(); // QByteArray data is at least 8 byte aligned
+    }
+
+    return openData(data, size);
+}
+
+bool ItemDatabase::openData(const char *data, const qint64 size)
+{
+    if (size_t(size) < sizeof(itemdb::FileHeader)) {
+        qWarning() << "Item database too small" << size;
+        return false;
+    }
+    const itemdb::FileHeader *header = reinterpret_cast<const itemdb::FileHeader*>(data);
+    if (memcmp(header->magic, itemdb::magic, sizeof(itemdb::magic)) != 0) {
+        qWarning() << "Invalid item database magic";
+        return false;
+    }
+    if (header->version != itemdb::formatVersion) {
+        qWarning() << "Wrong item database version" << header->version << "expected" << itemdb::formatVersion;
+        return false;
+    }
+    if (header->sectionCount != uint32_t(itemdb::Section::Count) || header->totalSize != size) {
+        qWarning() << "Invalid item database, sections:" << header->sectionCount << "size" << header->totalSize << size;
+        return false;
+    }
+
+    const itemdb::SectionEntry *sections = reinterpret_cast<const itemdb::SectionEntry*>(data + sizeof(itemdb::FileHeader));
+    for (uint32_t i=0; i<header->sectionCount; i++) {
+        if (quint64(sections[i].offset) + sections[i].size > quint64(size) || sections[i].offset % 8) {
+            qWarning() << "Invalid item database section" << i;
+            return false;
+        }
+    }
+
+    m_data = data;
+    m_sections = sections;
+    m_strings = reinterpret_cast<const QChar*>(data + sections[uint32_t(itemdb::Section::Strings)].offset);
+    m_stringCount = sections[uint32_t(itemdb::Section::Strings)].size / sizeof(QChar);
+
+    return true;
+}
+
+QStringList ItemDatabase::stringList(const itemdb::Section section, const uint32_t first, const uint32_t count) const
+{
+    int total = 0;
+    const itemdb::StringRef *refs = records<itemdb::StringRef>(section, &total);
+    if (quint64(first) + count > quint64(total)) {
+        qWarning() << "Invalid string list" << first << count << total;
+        return {};
+    }
+
+    QStringList ret;
+    ret.reserve(int(count));
+    for (uint32_t i=first; i<first + count; i++) {
+        ret.append(string(refs[i]));
+    }
+    return ret;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "ItemDatabaseFormat.h"
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+// Read only view of the item database blob that is generated at build time
+// and embedded uncompressed, so nothing is parsed or copied when starting.
+class ItemDatabase
+{
+public:
+    // Either the one built in, or a file made with ItemDatabaseCompiler
+    // (which is read into memory)
+    bool open(const QString &path = QStringLiteral(":/itemdb.bin"));
+    bool isOpen() const { return m_data != nullptr; }
+
+    // Points straight into the blob, so no allocation or copy
+    QString string(const itemdb::StringRef &ref) const {
+        Q_ASSERT(quint64(ref.offset) + ref.length <= m_stringCount);
+        return QString::fromRawData(m_strings + ref.offset, int(ref.length));
+    }
+
+    // For the PartLists etc., where the StringRef is an offset and count into a section
+    QStringList stringList(const itemdb::Section section, const uint32_t first, const uint32_t count) const;
+
+    template <typename T>
+    const T *records(const itemdb::Section section, int *count) const {
+        const itemdb::SectionEntry &entry = m_sections[uint32_t(section)];
+        *count = int(entry.size / sizeof(T));
+        return reinterpret_cast<const T*>(m_data + entry.offset);
+    }
+
+private:
+    bool openData(const char *data, const qint64 size);
+
+    QByteArray m_alignedCopy; // only if the resource data isn't aligned, or it is from a file
+    const char *m_data = nullptr;
+    const itemdb::SectionEntry *m_sections = nullptr;
+    const QChar *m_strings = nullptr;
+    uint32_t m_stringCount = 0;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+
+// Layout of the item database that tools/ItemDatabaseCompiler.cpp builds from
+// the json and tsv files in data/ at build time, so we don't have to parse
+// them every time we start.
+//
+// A FileHeader, then one SectionEntry per Section, then the sections. All
+// little endian, sections are 8 byte aligned so they can be used in place.
+// Bump formatVersion when anything here changes.
+namespace itemdb {
+
+static constexpr char magic[4] = { 'B', 'L', '3', 'D' };
+static constexpr uint32_t formatVersion = 1;
+
+enum class Section : uint32_t {
+    Strings = 0, // UTF-16, so QString::fromRawData() can use them directly
+    EnglishNames, // NamePair, keys are lower case
+    PartCategories, // NamePair, keys are lower case
+    Categories, // Category
+    CategoryAssets, // StringRef
+    CategoryVersions, // CategoryVersion, in increasing version order for each category
+    Parts, // Part
+    PartLists, // StringRef, the dependencies and excluders for the parts
+    Descriptions, // Description
+    ItemInfos, // ItemInfo
+
+    Count
+};
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t sectionCount;
+    uint32_t totalSize;
+};
+
+struct SectionEntry {
+    uint32_t offset; // from the start of the file
+    uint32_t size; // in bytes
+};
+
+// In UTF-16 code units from the start of the string section
+struct StringRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct NamePair {
+    StringRef key;
+    StringRef value;
+};
+
+struct Category {
+    StringRef name;
+    uint32_t firstAsset;
+    uint32_t assetCount;
+    uint32_t firstVersion;
+    uint32_t versionCount;
+};
+
+struct CategoryVersion {
+    uint32_t version;
+    uint32_t bits;
+};
+
+struct Part {
+    StringRef manufacturer;
+    StringRef itemType;
+    StringRef rarity;
+    StringRef balance;
+    StringRef category;
+    StringRef partId;
+    int32_t minParts;
+    int32_t maxParts;
+    float weight;
+    uint32_t firstDependency;
+    uint32_t dependencyCount;
+    uint32_t firstExcluder;
+    uint32_t excluderCount;
+};
+
+struct Description {
+    StringRef id;
+    StringRef positives;
+    StringRef negatives;
+    StringRef effects;
+    StringRef naming;
+};
+
+struct ItemInfo {
+    StringRef assetName;
+    StringRef inventoryName;
+    StringRef inventoryNameLocationKey;
+    int32_t inventoryCategoryHash;
+    float inventorySize;
+    int32_t monetaryValue;
+    float baseMonetaryValueModifier;
+    uint8_t usesInventoryScore;
+    uint8_t canDropOrSell;
+    uint8_t padding[2];
+};
+
+// So the compiler and the editor agree, and nothing has padding we forget to zero
+static_assert(sizeof(FileHeader) == 16, "Unexpected padding");
+static_assert(sizeof(SectionEntry) == 8, "Unexpected padding");
+static_assert(sizeof(StringRef) == 8, "Unexpected padding");
+static_assert(sizeof(NamePair) == 16, "Unexpected padding");
+static_assert(sizeof(Category) == 24, "Unexpected padding");
+static_assert(sizeof(CategoryVersion) == 8, "Unexpected padding");
+static_assert(sizeof(Part) == 76, "Unexpected padding");
+static_assert(sizeof(Description) == 40, "Unexpected padding");
+static_assert(sizeof(ItemInfo) == 44, "Unexpected padding");
+
+} // namespace itemdb
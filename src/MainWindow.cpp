@@ -82,7 +82,22 @@ void MainWindow::loadFile()
         }
     }
 
-    if (!m_savegame->load(m_filePath)) {
+    const bool loaded = m_savegame->load(m_filePath, true);
+
+    // Show everything that went wrong in one go, items that are only read
+    // only aren't worth a dialog but are in the details if there is one
+    const DecodeReport &report = m_savegame->decodeReport();
+    if (!loaded || report.hasErrors()) {
+        QMessageBox messageBox(QMessageBox::Warning, loaded ? tr("Problems loading file") : tr("Failed to load file"), {}, QMessageBox::Ok, this);
+        if (loaded) {
+            messageBox.setText(tr("%1 items failed to load, and some might be read only.\n%2").arg(report.failedItemsCount()).arg(report.errorCounts(false)));
+            messageBox.setDetailedText(report.toText());
+        } else {
+            messageBox.setText(report.toText());
+        }
+        messageBox.exec();
+    }
+    if (!loaded) {
         return;
     }
     QSettings settings;
@@ -0,0 +1,270 @@
+#include "PartConstraints.h"
+
+#include "ItemData.h"
+#include "InventoryItem.h"
+
+bool PartSet::isEmpty() const
+{
+    for (const quint64 word : m_words) {
+        if (word) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PartSet::intersects(const PartSet &other) const
+{
+    Q_ASSERT(m_words.count() == other.m_words.count());
+    for (int i=0; i<m_words.count(); i++) {
+        if (m_words[i] & other.m_words[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int PartSet::count() const
+{
+    int count = 0;
+    for (const quint64 word : m_words) {
+        count += int(qPopulationCount(word));
+    }
+    return count;
+}
+
+PartSet &PartSet::operator|=(const PartSet &other)
+{
+    Q_ASSERT(m_words.count() == other.m_words.count());
+    for (int i=0; i<m_words.count(); i++) {
+        m_words[i] |= other.m_words[i];
+    }
+    return *this;
+}
+
+PartSet PartSet::operator&(const PartSet &other) const
+{
+    Q_ASSERT(m_words.count() == other.m_words.count());
+    PartSet ret(*this);
+    for (int i=0; i<m_words.count(); i++) {
+        ret.m_words[i] &= other.m_words[i];
+    }
+    return ret;
+}
+
+PartConstraints::PartConstraints(const QVector<ItemPart> &parts)
+{
+    // In the order they're in the files, and only the first time a part is
+    // listed counts (the same part can be in several categories, mostly "None")
+    QHash<StringId, int> categoryIndexes;
+    QVector<const ItemPart*> firstRows;
+    for (const ItemPart &part : parts) {
+        if (part.partId == StringPool::null || m_partIndexes.contains(part.partId)) {
+            continue;
+        }
+
+        int category = categoryIndexes.value(part.category, -1);
+        if (category == -1) {
+            category = m_categories.count();
+            categoryIndexes.insert(part.category, category);
+
+            Category newCategory;
+            newCategory.name = part.category;
+            newCategory.minParts = part.minParts;
+            newCategory.maxParts = part.maxParts;
+            m_categories.append(newCategory);
+        }
+
+        Part newPart;
+        newPart.id = part.partId;
+        newPart.category = category;
+        m_partIndexes.insert(part.partId, m_parts.count());
+        m_parts.append(newPart);
+        firstRows.append(&part);
+    }
+
+    // Dependencies and excluders aren't always parts this balance can have,
+    // but they still need a bit in case an item has them anyways
+    for (const ItemPart *part : firstRows) {
+        for (const QVector<StringId> *list : { &part->dependencies, &part->excluders }) {
+            for (const StringId other : *list) {
+                if (other == StringPool::null || m_partIndexes.contains(other)) {
+                    continue;
+                }
+                Part newPart;
+                newPart.id = other;
+                m_partIndexes.insert(other, m_parts.count());
+                m_parts.append(newPart);
+            }
+        }
+    }
+
+    // Now we know how many bits we need
+    const int size = m_parts.count();
+    for (Part &part : m_parts) {
+        part.dependencies = PartSet(size);
+        part.excluders = PartSet(size);
+        part.affects = PartSet(size);
+    }
+
+    for (int index=0; index<firstRows.count(); index++) {
+        Part &part = m_parts[index];
+        for (const StringId dependency : firstRows[index]->dependencies) {
+            const int other = m_partIndexes.value(dependency, -1);
+            if (other < 0) {
+                continue;
+            }
+            part.dependencies.set(other);
+            m_parts[other].affects.set(index);
+        }
+        for (const StringId excluder : firstRows[index]->excluders) {
+            const int other = m_partIndexes.value(excluder, -1);
+            if (other < 0) {
+                continue;
+            }
+            part.excluders.set(other);
+            m_parts[other].affects.set(index);
+        }
+    }
+}
+
+QVector<StringId> PartConstraints::itemPartIds(const InventoryItem &item)
+{
+    QVector<StringId> ret;
+    ret.reserve(item.parts.count());
+    for (const InventoryItem::Aspect &part : item.parts) {
+        ret.append(ItemData::objectShortName(part.val));
+    }
+    return ret;
+}
+
+QVector<PartConstraints::Violation> PartConstraints::check(const QVector<StringId> &partIds) const
+{
+    PartSelection selection(this);
+    for (const StringId partId : partIds) {
+        selection.setEnabled(partId, true);
+    }
+    return selection.violations();
+}
+
+PartSelection::PartSelection(const PartConstraints *constraints) :
+    m_constraints(constraints),
+    m_enabled(constraints->partCount()),
+    m_brokenParts(constraints->partCount()),
+    m_categoryCounts(constraints->categoryCount(), 0)
+{
+}
+
+void PartSelection::setEnabled(const StringId partId, const bool enabled)
+{
+    const int part = m_constraints->partIndex(partId);
+    if (part >= 0) {
+        setPartEnabled(part, enabled);
+    } else if (enabled) {
+        m_unknownParts.insert(partId);
+    } else {
+        m_unknownParts.remove(partId);
+    }
+}
+
+bool PartSelection::isEnabled(const StringId partId) const
+{
+    const int part = m_constraints->partIndex(partId);
+    if (part >= 0) {
+        return m_enabled.test(part);
+    }
+    return m_unknownParts.contains(partId);
+}
+
+void PartSelection::setPartEnabled(const int part, const bool enabled)
+{
+    if (m_enabled.test(part) == enabled) {
+        return;
+    }
+    m_enabled.set(part, enabled);
+
+    // Only mentioned as a dependency or excluder, so the balance can't have
+    // it. It still counts for the parts that depend on it.
+    const int category = m_constraints->m_parts[part].category;
+    if (category < 0) {
+        if (enabled) {
+            m_unknownParts.insert(m_constraints->m_parts[part].id);
+        } else {
+            m_unknownParts.remove(m_constraints->m_parts[part].id);
+        }
+    } else {
+        const bool wasValid = isCategoryValid(category);
+        m_categoryCounts[category] += enabled ? 1 : -1;
+        const bool valid = isCategoryValid(category);
+        if (valid != wasValid) {
+            m_badCategories += valid ? -1 : 1;
+        }
+    }
+
+    // Nothing else can have changed
+    updatePart(part);
+    m_constraints->m_parts[part].affects.forEach([this](const int affected) {
+        updatePart(affected);
+    });
+}
+
+void PartSelection::updatePart(const int part)
+{
+    const PartConstraints::Part &info = m_constraints->m_parts[part];
+    const bool missingDependency = !info.dependencies.isEmpty() && !info.dependencies.intersects(m_enabled);
+    m_brokenParts.set(part, m_enabled.test(part) && (missingDependency || info.excluders.intersects(m_enabled)));
+}
+
+bool PartSelection::isCategoryValid(const int category) const
+{
+    return m_constraints->isValidCount(category, m_categoryCounts[category]);
+}
+
+QVector<PartConstraints::Violation> PartSelection::violations() const
+{
+    QVector<PartConstraints::Violation> ret;
+    if (isValid()) {
+        return ret;
+    }
+
+    m_brokenParts.forEach([this, &ret](const int part) {
+        const PartConstraints::Part &info = m_constraints->m_parts[part];
+        if (!info.dependencies.isEmpty() && !info.dependencies.intersects(m_enabled)) {
+            PartConstraints::Violation violation;
+            violation.type = PartConstraints::Violation::MissingDependency;
+            violation.part = part;
+            ret.append(violation);
+        }
+        info.excluders.forEach([this, &ret, part](const int excluder) {
+            if (!m_enabled.test(excluder)) {
+                return;
+            }
+            PartConstraints::Violation violation;
+            violation.type = PartConstraints::Violation::Excluded;
+            violation.part = part;
+            violation.other = excluder;
+            ret.append(violation);
+        });
+    });
+
+    for (const StringId unknownPart : m_unknownParts) {
+        PartConstraints::Violation violation;
+        violation.type = PartConstraints::Violation::UnknownPart;
+        violation.unknownPart = unknownPart;
+        ret.append(violation);
+    }
+
+    for (int category=0; category<m_categoryCounts.count(); category++) {
+        if (isCategoryValid(category)) {
+            continue;
+        }
+        PartConstraints::Violation violation;
+        violation.type = m_categoryCounts[category] < m_constraints->m_categories[category].minParts ?
+                    PartConstraints::Violation::TooFewParts : PartConstraints::Violation::TooManyParts;
+        violation.category = category;
+        violation.count = m_categoryCounts[category];
+        ret.append(violation);
+    }
+
+    return ret;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "StringPool.h"
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QtAlgorithms>
+
+#include <cstdint>
+
+struct ItemPart;
+struct InventoryItem;
+
+// Just enough of a bitset, one bit per part of a balance. All the sets for a
+// balance have the same size.
+class PartSet
+{
+public:
+    PartSet() = default;
+    explicit PartSet(const int size) : m_words((size + 63) / 64, 0) {}
+
+    bool test(const int bit) const { return m_words[bit >> 6] & (quint64(1) << (bit & 63)); }
+    void set(const int bit, const bool on = true) {
+        if (on) {
+            m_words[bit >> 6] |= quint64(1) << (bit & 63);
+        } else {
+            m_words[bit >> 6] &= ~(quint64(1) << (bit & 63));
+        }
+    }
+
+    bool isEmpty() const;
+    bool intersects(const PartSet &other) const;
+    int count() const;
+
+    PartSet &operator|=(const PartSet &other);
+    PartSet operator&(const PartSet &other) const;
+    bool operator==(const PartSet &other) const { return m_words == other.m_words; }
+    bool operator!=(const PartSet &other) const { return m_words != other.m_words; }
+    friend uint qHash(const PartSet &set, const uint seed = 0) { return qHash(set.m_words, seed); }
+
+    // Calls func(bit) for each bit that is set, in order
+    template<typename FUNC>
+    void forEach(FUNC func) const {
+        for (int word=0; word<m_words.count(); word++) {
+            quint64 bits = m_words[word];
+            while (bits) {
+                func(word * 64 + int(qCountTrailingZeroBits(bits)));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+private:
+    QVector<quint64> m_words;
+};
+
+// What parts a balance can have, from the part tsv files: how many from each
+// category, and which parts need or can't be combined with others. Built
+// once per balance with a bit per part, so checking an item is a handful of
+// bit operations instead of comparing strings.
+class PartConstraints
+{
+public:
+    struct Category {
+        StringId name = StringPool::null;
+        int minParts = 0;
+        int maxParts = 0;
+    };
+
+    struct Violation {
+        enum Type {
+            MissingDependency, // part needs one of its dependencies
+            Excluded, // part can't be combined with other
+            TooFewParts, // category has count parts
+            TooManyParts, // category has count parts
+            UnknownPart, // unknownPart isn't a part of this balance
+        };
+        Type type = MissingDependency;
+        int part = -1;
+        int other = -1;
+        int category = -1;
+        int count = 0;
+        StringId unknownPart = StringPool::null;
+    };
+
+    PartConstraints() = default;
+    explicit PartConstraints(const QVector<ItemPart> &parts);
+
+    bool isEmpty() const { return m_parts.isEmpty(); }
+
+    // Includes the parts that are only mentioned as dependencies or excluders,
+    // they don't have a category
+    int partCount() const { return m_parts.count(); }
+    int partIndex(const StringId partId) const { return m_partIndexes.value(partId, -1); }
+    StringId partId(const int part) const { return m_parts[part].id; }
+    int partCategory(const int part) const { return m_parts[part].category; }
+    const PartSet &dependencies(const int part) const { return m_parts[part].dependencies; }
+    const PartSet &excluders(const int part) const { return m_parts[part].excluders; }
+
+    int categoryCount() const { return m_categories.count(); }
+    const Category &category(const int category) const { return m_categories[category]; }
+
+    // Empty categories are fine, a lot of them have a minimum of one but it
+    // is a "None" part that isn't in the serial. Otherwise it has to be
+    // between the minimum and maximum.
+    bool isValidCount(const int category, const int count) const {
+        return count == 0 || (count >= m_categories[category].minParts && count <= m_categories[category].maxParts);
+    }
+
+    // Short names of the parts the item has, like the part ids in the tsv files
+    static QVector<StringId> itemPartIds(const InventoryItem &item);
+
+    // Everything that is wrong with these parts together
+    QVector<Violation> check(const QVector<StringId> &partIds) const;
+
+private:
+    friend class PartSelection;
+
+    struct Part {
+        StringId id = StringPool::null;
+        int category = -1;
+        PartSet dependencies; // needs at least one of these, if any
+        PartSet excluders;
+        PartSet affects; // the parts that have this as a dependency or excluder
+    };
+
+    QVector<Part> m_parts;
+    QVector<Category> m_categories;
+    QHash<StringId, int> m_partIndexes;
+};
+
+// The parts that are enabled for an item, and what is wrong with them. When
+// a part is flipped only that part and the ones that depend on or exclude it
+// are checked again.
+class PartSelection
+{
+public:
+    explicit PartSelection(const PartConstraints *constraints);
+
+    // Parts not in the balance (including the ones that are only there as
+    // dependencies or excluders) are kept track of, but are always a violation
+    void setEnabled(const StringId partId, const bool enabled);
+    void setPartEnabled(const int part, const bool enabled);
+    bool isEnabled(const StringId partId) const;
+    bool isPartEnabled(const int part) const { return m_enabled.test(part); }
+    const PartSet &enabled() const { return m_enabled; }
+
+    bool isValid() const { return m_brokenParts.isEmpty() && m_badCategories == 0 && m_unknownParts.isEmpty(); }
+    QVector<PartConstraints::Violation> violations() const;
+
+private:
+    void updatePart(const int part);
+    bool isCategoryValid(const int category) const;
+
+    const PartConstraints *m_constraints;
+    PartSet m_enabled;
+    PartSet m_brokenParts; // enabled, and missing a dependency or with something it excludes
+    QVector<int> m_categoryCounts;
+    int m_badCategories = 0;
+    QSet<StringId> m_unknownParts;
+};
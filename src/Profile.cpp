@@ -0,0 +1,114 @@
+#include "Profile.h"
+
+#include "OakProfile.pb.h"
+
+#include <google/protobuf/arena.h>
+
+#include "ItemCodec.h"
+#include "ItemData.h"
+#include "BackupStore.h"
+
+#include <QMessageBox>
+#include <QDebug>
+
+Profile::Profile(QObject *parent) :
+    QObject(parent)
+{
+    m_arena = std::make_unique<google::protobuf::Arena>();
+    m_profile = google::protobuf::Arena::CreateMessage<OakSave::Profile>(m_arena.get());
+}
+
+Profile::~Profile()
+{ // unique_ptr with forward declared class
+}
+
+bool Profile::load(const QString &filePath, const bool makeBackup)
+{
+    ItemData::ready().waitForFinished(); // usually done already
+    if (!ItemData::isValid()) {
+        qWarning() << "Databases not loaded!";
+        return false;
+    }
+    m_header = {};
+    m_bankItems.clear();
+    m_lostLootItems.clear();
+    m_report.clear();
+
+    GvasFile file;
+    if (!file.open(filePath, &m_report)) {
+        return false;
+    }
+    m_header = file.header();
+
+    // Everything from the last one goes away at once
+    m_profile = nullptr;
+    m_arena = std::make_unique<google::protobuf::Arena>();
+    m_profile = google::protobuf::Arena::CreateMessage<OakSave::Profile>(m_arena.get());
+
+    if (!file.parseBody(m_profile, &m_report)) {
+        return false;
+    }
+
+    qDebug() << "Bank items:" << m_profile->bank_inventory_list_size() << "lost loot:" << m_profile->lost_loot_inventory_list_size();
+
+    // The bank can be huge, so decode it all in one go in parallel, with the lost loot in the same batch
+    QVector<const std::string*> serials;
+    serials.reserve(m_profile->bank_inventory_list_size() + m_profile->lost_loot_inventory_list_size());
+    for (const std::string &serial : m_profile->bank_inventory_list()) {
+        serials.append(&serial);
+    }
+    for (const std::string &serial : m_profile->lost_loot_inventory_list()) {
+        serials.append(&serial);
+    }
+    const QVector<DecodedItem> decodedItems = ItemCodec::decodeAll(serials);
+
+    const int bankCount = m_profile->bank_inventory_list_size();
+    addDecodedItems(decodedItems, 0, bankCount, &m_bankItems);
+    addDecodedItems(decodedItems, bankCount, decodedItems.count() - bankCount, &m_lostLootItems);
+    emit itemsChanged();
+
+    // Only writes anything if we haven't seen this exact file before
+    if (makeBackup) {
+        BackupStore backups(file.fileName());
+        if (!backups.store(file.rawContents())) {
+            qWarning() << "Failed to back up" << file.fileName() << "to" << backups.directory();
+        }
+    }
+    file.close();
+
+    emit fileLoaded();
+
+    return true;
+}
+
+void Profile::addDecodedItems(const QVector<DecodedItem> &decoded, const int first, const int count, QVector<InventoryItem> *items)
+{
+    items->reserve(count);
+    for (int itemIndex=first; itemIndex<first + count; itemIndex++) {
+        Diagnostic diagnostic = decoded[itemIndex].diagnostic;
+        diagnostic.itemIndex = itemIndex;
+
+        if (!decoded[itemIndex].item.isValid()) {
+            if (!diagnostic.isError()) {
+                diagnostic.error = DecodeError::InvalidItem;
+                diagnostic.message = tr("Unsupported item %1").arg(decoded[itemIndex].item.name);
+            }
+            qWarning() << "Invalid item:" << itemIndex << diagnostic.message;
+            m_report.add(diagnostic);
+            continue;
+        }
+        m_report.add(diagnostic);
+        items->append(decoded[itemIndex].item);
+    }
+}
+
+bool Profile::save(const QString &filePath) const
+{
+    const QString error = GvasFile::write(filePath, m_header, *m_profile);
+    if (!error.isEmpty()) {
+        QMessageBox::warning(nullptr, "Failed to save", error);
+        return false;
+    }
+
+    return true;
+}
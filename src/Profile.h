@@ -0,0 +1,63 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "InventoryItem.h"
+#include "DecodeReport.h"
+#include "GvasFile.h"
+
+#include <memory>
+#include <QObject>
+#include <QVector>
+
+namespace OakSave {
+class Profile;
+}
+namespace google {
+namespace protobuf {
+class Arena;
+}
+}
+
+struct DecodedItem;
+
+// profile.sav, the settings and everything shared between the characters,
+// like the bank and the lost loot machine.
+class Profile : public QObject
+{
+    Q_OBJECT
+
+public:
+    Profile(QObject *parent);
+    virtual ~Profile();
+
+    // Only backs it up (see BackupStore) if asked, batch mode shouldn't write anything
+    bool load(const QString &filePath, const bool makeBackup = false);
+    bool save(const QString &filePath) const;
+
+    // Only the items that could be decoded, like Savegame::items()
+    const QVector<InventoryItem> &bankItems() const { return m_bankItems; }
+    const QVector<InventoryItem> &lostLootItems() const { return m_lostLootItems; }
+
+    int failedItemsCount() const { return m_report.failedItemsCount(); }
+
+    // Item indexes are the bank first, then the lost loot after it
+    const DecodeReport &decodeReport() const { return m_report; }
+
+signals:
+    void itemsChanged();
+    void fileLoaded();
+
+private:
+    void addDecodedItems(const QVector<DecodedItem> &decoded, const int first, const int count, QVector<InventoryItem> *items);
+
+    GvasFile::Header m_header{};
+
+    std::unique_ptr<google::protobuf::Arena> m_arena;
+    OakSave::Profile *m_profile = nullptr; // owned by m_arena
+
+    QVector<InventoryItem> m_bankItems;
+    QVector<InventoryItem> m_lostLootItems;
+    DecodeReport m_report;
+};
+
+#endif // PROFILE_H
@@ -2,81 +2,21 @@
 
 #include "OakSave.pb.h"
 
+#include <google/protobuf/arena.h>
+
 #include "obfuscation.h"
+#include "ItemCodec.h"
+#include "GvasFile.h"
+#include "BackupStore.h"
 
-#include <QBitArray>
-#include <QFile>
 #include <QMessageBox>
-#include <QtEndian> // all the qFromLittleEndian is valid for the PC saves at least
 #include <QDebug>
-#include <QtMath>
 #include <deque>
 
-//#include <bitset> // More stuff that we want than QBitSet (like shifting) fuck std
-
-// Idea stolen wholesale from CJ
-// I'm not in the mood to write a long switch-case-shift-bits-thing
-struct BitParser
-{
-    BitParser() = default;
-
-    BitParser(const QByteArray &data)
-    {
-        QBitArray bits = QBitArray::fromBits(data.data(), data.size() * 8);
-        for (int i=0; i < bits.size(); i++) {
-            m_bits.append(bits[i] ? '1' : '0');
-        }
-    }
-
-    int bitsLeft() const {
-        return m_bits.count();
-    }
-
-    void put(const uint64_t number, const uint64_t count) {
-        if (count >= sizeof(number) * 8) {
-            qWarning() << "Trying to store invalid amount of bits" << count;
-            return;
-        }
-        QBitArray bits = QBitArray::fromBits(reinterpret_cast<const char*>(&number), count);
-        for (int i=0; i < bits.size(); i++) {
-            m_bits.append(bits[i] ? '1' : '0');
-        }
-    }
-
-    QByteArray toBinaryData() const {
-        QBitArray bits(m_bits.count());
-        for (int i=0; i<m_bits.length(); i++) {
-            bits.setBit(i, m_bits[i] == '1');
-        }
-
-        return QByteArray(bits.bits(), qCeil(bits.size() / 8.));
-    }
-    QByteArray asOnesAndZeros();
-
-    int eat(const int count) {
-        if (count <= 0) {
-            return 0;
-        }
-        if (count > m_bits.size()) {
-            qWarning() << "Invalid amount of bits requested" << count << "only have" << m_bits.size();
-            return -1;
-        }
-
-        QByteArray toEat = m_bits.mid(0, count);
-        m_bits = m_bits.mid(count);
-        std::reverse(toEat.begin(), toEat.end()); // idk lol I don't know computer
-
-        bool ok; // lol as if
-        return toEat.toInt(&ok, 2);
-    }
-    QByteArray m_bits;
-private:
-};
-
 Savegame::Savegame(QObject *parent) :
     QObject(parent)
 {
-    m_character = std::make_unique<OakSave::Character>();
+    resetArena(0);
 
 #if 0
     QFile infile("name.json");
@@ -91,284 +31,99 @@ Savegame::~Savegame()
 { // can't be inline or default, because unique_ptr in gcc is short-bus special
 }
 
-static QByteArray deobfuscateItem(const QByteArray &input)
-{
-    if (input.size() < 6) {
-        QMessageBox::warning(nullptr, "Invalid file", QObject::tr("Invalid item serial (too short: %1).").arg(input.size()));
-        return {};
-    }
-    if (input[0] != 3) {
-        QMessageBox::warning(nullptr, "Invalid file", QObject::tr("Invalid item (item serial doesn't start with 3, got %1).").arg(int(input[0])));
-        return {};
-    }
-
-    const int32_t seed = qFromBigEndian<int32_t>(input.data() + 1);
-
-    QByteArray data = input.mid(5); // 1 first byte is 3, 4 bytes is int seed
-
-    if (seed != 0) {
-        uint32_t key = (seed >> 5) & 0xFFFFFFFF;
-        for (char &c : data) {
-            key = (key * obfuscation::itemKey) % obfuscation::itemMask;
-            c ^= key;
-        }
-        const int steps = (seed & 0x1f) % data.size();
-        std::rotate(data.rbegin(), data.rbegin() + steps, data.rend());
-    } else {
-        qWarning() << "0 seed?";
-    }
-
-    // Normal crc32
-    const QByteArray toChecksum = input.mid(0, 5) + "\xff\xff" + data.mid(2);
-    uint32_t crc32 = 0xffffffff;
-    for (const char c : toChecksum) {
-        uint32_t val = (crc32 ^ c) & 0xff;
-        for (int i=0; i<8; i++) {
-            val = (val & 1) ? (val >>1 ) ^ 0xedb88320 : val >> 1;
-        }
-        crc32 = val ^ (crc32 >> 8);
-    }
-    crc32 ^= 0xffffffff;
-
-    const uint16_t computedChecksum = (crc32 >> 16) ^ crc32;
-    const uint16_t checksum = qFromBigEndian<uint16_t>(data.data());
-    if (computedChecksum != checksum) {
-        QMessageBox::warning(nullptr, "Invalid file", QObject::tr("Invalid item (checksum failed)."));
-        qWarning() << "Checksum mismatch" << computedChecksum << "expected" << checksum;
-        return {};
-    }
-
-    return data.mid(2);
-}
-
-// extremely inefficient, but can't be bothered to think
-static QByteArray obfuscateItem(QByteArray input, const int seed)
+void Savegame::resetArena(const size_t expectedSize)
 {
-    if (input.isEmpty()) {
-        qWarning() << "Can't obfuscate empty string";
-        return {};
-    }
-
-    QByteArray ret(5, 0);
-    ret[0] = 3;
-    qToBigEndian(seed, ret.data() + 1);
+    m_character = nullptr;
 
-    const QByteArray toChecksum = ret + "\xff\xff" + input;
-    uint32_t crc32 = 0xffffffff;
-    for (const char c : toChecksum) {
-        uint32_t val = (crc32 ^ c) & 0xff;
-        for (int i=0; i<8; i++) {
-            val = (val & 1) ? (val >>1 ) ^ 0xedb88320 : val >> 1;
-        }
-        crc32 = val ^ (crc32 >> 8);
+    size_t wantedSize = expectedSize;
+    if (m_arena) {
+        // In case we load the same or a similar file again
+        wantedSize = qMax(wantedSize, size_t(m_arena->SpaceUsed()));
+        m_arena->Reset();
     }
-    crc32 ^= 0xffffffff;
-
-    const uint16_t computedChecksum = (crc32 >> 16) ^ crc32;
 
-    QByteArray checksumBytes(sizeof(computedChecksum), 0);
-    qToBigEndian(computedChecksum, checksumBytes.data());
-    input.prepend(checksumBytes);
+    // Only need a new one if the old first block is too small
+    if (!m_arena || wantedSize > m_arenaBlockSize) {
+        m_arena.reset(); // before the block it uses
 
-    if (seed != 0) {
-        const int steps = (seed & 0x1f) % input.size();
-        std::rotate(input.begin(), input.begin() + steps, input.end());
-        uint32_t key = (seed >> 5) & 0xFFFFFFFF;
-        for (char &c : input) {
-            key = (key * obfuscation::itemKey) % obfuscation::itemMask;
-            c ^= key;
+        google::protobuf::ArenaOptions options;
+        if (wantedSize > 0) {
+            m_arenaBlock.reset(new char[wantedSize]);
+            m_arenaBlockSize = wantedSize;
+            options.initial_block = m_arenaBlock.get();
+            options.initial_block_size = m_arenaBlockSize;
         }
+        m_arena = std::make_unique<google::protobuf::Arena>(options);
     }
 
-    ret.append(input);
-
-    return ret;
+    m_character = google::protobuf::Arena::CreateMessage<OakSave::Character>(m_arena.get());
 }
 
-// could be simpler and more efficient and who uses powerpc these days, but meh
-template <typename T>
-static bool readInt(T *output, QIODevice *input)
-{
-    char data[sizeof(T)];
-    if (input->read(data, sizeof(data)) != qint64(sizeof(data))) {
-        return false;
-    }
-    *output = qFromLittleEndian<T>(data);
-    return true;
-}
-
-template <typename T>
-static bool writeInt(const T input, QIODevice *output)
-{
-    char data[sizeof(T)];
-    qToLittleEndian(input, data);
-    const qint64 written = output->write(data, sizeof(data));
-    if (written != qint64(sizeof(data))) {
-        qWarning() << "short writE" << written << sizeof(data);
-        return false;
-    }
-    return true;
-}
-
-static bool readString(QString *output, QIODevice *input)
-{
-    int stringLength;
-    if (!readInt(&stringLength, input) || stringLength < 0) {
-        return false;
-    }
-
-    // just an empty string, because it's supposed to be 0 terminated
-    if (stringLength <= 1) {
-        return true;
-    }
-    *output = QString::fromUtf8(input->read(stringLength), stringLength - 1); // Supposed to be \0-terminated, but just in case
-    return true;
-}
-
-static bool writeString(const QString &input, QIODevice *output)
-{
-    const QByteArray utf8 = input.toUtf8() + '\0';
-    const int stringLength = utf8.length();
-    if (!writeInt(stringLength, output) || stringLength < 0) {
-        return false;
-    }
-
-    output->write(utf8);
-
-    return true;
-}
-
-bool Savegame::load(const QString &filePath)
+bool Savegame::load(const QString &filePath, const bool makeBackup)
 {
+    ItemData::ready().waitForFinished(); // usually done already
     if (!ItemData::isValid()) {
         qWarning() << "Databases not loaded!";
         return false;
     }
     m_header = {};
+    m_items.clear();
+    m_itemSerialIndices.clear();
+    m_dirtyItems.clear();
+    m_report.clear();
 
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        QMessageBox::warning(nullptr, "Failed to open file", file.errorString());
+    GvasFile file;
+    if (!file.open(filePath, &m_report)) {
         return false;
     }
+    m_header = file.header();
 
-    const QByteArray fileMagic = file.read(4);
-    if (fileMagic != "GVAS") {
-        QMessageBox::warning(nullptr, "Invalid header", "Invalid file, starts with:\n" + fileMagic.toHex() + "'.");
-        return false;
-    }
-    bool couldReadHeader =
-            readInt(&m_header.savegameVersion, &file) &&
-            readInt(&m_header.packageVersion, &file) &&
-            readInt(&m_header.engineMajorVersion, &file) &&
-            readInt(&m_header.engineMinorVersion, &file) &&
-            readInt(&m_header.enginePatchVersion, &file) &&
-            readInt(&m_header.engineBuild, &file) &&
-            readString(&m_header.buildId, &file) &&
-            readInt(&m_header.customFormatVersion, &file) &&
-            readInt(&m_header.customFormatCount, &file);
-
-    if (!couldReadHeader) {
-        QMessageBox::warning(nullptr, "Invalid header", "Invalid file, failed to read header.\n" + file.errorString());
-        return false;
-    }
-    if (m_header.customFormatCount > 1000) { // idk, just sanity
-        QMessageBox::warning(nullptr, "Invalid header", "Invalid file, too many custom formats: " + QString::number(m_header.customFormatCount));
-        return false;
-    }
-//    qDebug() << "Custom formats" << m_header.customFormatCount;
-
-    m_header.customFormats.resize(m_header.customFormatCount);
-
-    for (Header::CustomFormat &format : m_header.customFormats) {
-        format.id = QUuid::fromRfc4122(file.read(16));
-        if (format.id.isNull()) {
-            QMessageBox::warning(nullptr, "Invalid header", "Invalid custom format description id");
-            return false;
-        }
-        if (!readInt(&format.entry, &file)) {
-            QMessageBox::warning(nullptr, "Invalid header", "Invalid file, failed to read custom format entry index.\n" + file.errorString());
-            return false;
-        }
-//        qDebug() << "Format" << format.id << format.entry;
-    }
-    if (!readString(&m_header.savegameType, &file)) {
-        QMessageBox::warning(nullptr, "Invalid header", "Invalid file, failed to read savegame type.\n" + file.errorString());
-        return false;
-    }
-    if (!readInt(&m_header.dataLength, &file)) {
-            QMessageBox::warning(nullptr, "Invalid header", "Failed to read data length");
-            return false;
-    }
-
-    qDebug() << "Savegame version" << m_header.savegameType << m_header.savegameVersion;
-    qDebug() << "Package version" << m_header.packageVersion;
-    qDebug() << "Build id:" << m_header.buildId;
-    qDebug() << "Engine version" << m_header.engineMajorVersion << m_header.engineMinorVersion << m_header.enginePatchVersion << m_header.engineBuild;
-    qDebug() << "Custom format version" << m_header.customFormatVersion;
-
+    // Parsed messages are usually a few times bigger than the serialized data
+    resetArena(size_t(m_header.dataLength) * 3);
 
-    QByteArray data = file.readAll();
-    if (data.size() != m_header.dataLength) { // yeah yeah, padding, but it needs to be significantly larger so whatever
-        QMessageBox::warning(nullptr, "Failed to read from file", "Wrong amount of data available, expected " + QString::number(m_header.dataLength) + ", but got " + QString::number(data.size()));
+    if (!file.parseBody(m_character, &m_report)) {
         return false;
     }
 
-    char *dataRaw = data.data();
-    for (int i=data.size() - 1; i >= 0; i--) {
-        // I want a prize for ugly code
-        // Premature optimization^Wobfuscation (it's probably not faster than doing it the pretty way)
-        dataRaw[i] ^= (i < int(sizeof(obfuscation::prefixMask)) ? obfuscation::prefixMask[i] : dataRaw[i - sizeof(obfuscation::prefixMask)])
-            ^ obfuscation::xorMask[i % sizeof(obfuscation::xorMask)];
-    }
+    qDebug() << "Items:" << m_character->inventory_items_size();
 
-    if (!m_character->ParseFromArray(dataRaw, data.size())) {
-        // protobuf never gives us anything, but whatever
-        QMessageBox::warning(nullptr, "Invalid file", "Failed to parse file contents (protobuf parse failed):\n" + QString::fromStdString(m_character->InitializationErrorString()));
-        return false;
+    QVector<const std::string*> serials;
+    serials.reserve(m_character->inventory_items_size());
+    for (const OakSave::OakInventoryItemSaveGameData &entry : m_character->inventory_items()) {
+        serials.append(&entry.item_serial_number());
     }
+    // Only the header for now (enough for the name and level), the rest is decoded when the item is used
+    const QVector<DecodedItem> decodedItems = ItemCodec::decodeAll(serials, true);
 
-    if (!m_character->IsInitialized()) {
-        QMessageBox::warning(nullptr, "Invalid file", "Failed to parse file contents (protobuf not initialized):\n" + QString::fromStdString(m_character->InitializationErrorString()));
-        return false;
-    }
+    for (int itemIndex=0; itemIndex<decodedItems.count(); itemIndex++) {
+        Diagnostic diagnostic = decodedItems[itemIndex].diagnostic;
+        diagnostic.itemIndex = itemIndex;
 
-    qDebug() << "Items:" << m_character->inventory_items_size();
-//    int maxBits = 0;
-//    if (m_character->inventory_items_size() > 0) {
-    for (int itemIndex=0; itemIndex<m_character->inventory_items_size(); itemIndex++) {
-        const ::OakSave::OakInventoryItemSaveGameData& entry = m_character->inventory_items(itemIndex);
-        QByteArray deobfuscated = deobfuscateItem(QByteArray::fromStdString(entry.item_serial_number()));
-        QByteArray obfuscated = obfuscateItem(deobfuscated, qFromBigEndian<int32_t>(entry.item_serial_number().data() + 1));
-
-        if (entry.item_serial_number() != obfuscated.toStdString()) {
-            qWarning() << "OBfuscation failed" << deobfuscated.toHex(' ');
-            qDebug() << obfuscated.toHex(' ');
-            qDebug() << QByteArray::fromStdString(entry.item_serial_number()).toHex(' ');
-        }
-        InventoryItem item = parseItem(entry.item_serial_number());
-        if (item.isValid()) {
-            const std::string reEncoded = serializeItem(item);
-            if (entry.item_serial_number() == reEncoded){
-                item.writable = true;
-            } else {
-                qWarning() << "Re-encoding failed" << item.objectShortName;
-                qDebug() << "Encoded: " << QByteArray::fromStdString(reEncoded).toHex(' ');
-                qDebug() << "Original:" << deobfuscated.toHex(' ');
+        if (!decodedItems[itemIndex].item.isHeaderValid()) {
+            if (!diagnostic.isError()) {
+                diagnostic.error = DecodeError::InvalidItem;
+                diagnostic.message = tr("Unsupported item %1").arg(decodedItems[itemIndex].item.name);
             }
-
-            m_items.append(item);
-        } else {
-            qWarning() << "Invalid item:" << itemIndex;
+            qWarning() << "Invalid item:" << itemIndex << diagnostic.message;
+            m_report.add(diagnostic);
+            continue;
         }
+        m_report.add(diagnostic);
+        m_items.append(decodedItems[itemIndex].item);
+        m_itemSerialIndices.append(itemIndex);
     }
     emit itemsChanged();
 //    qDebug() << "Max bits:" << maxBits;
 
 
-    const QString backupFilename = file.fileName() + ".backup";
-    QFile::remove(backupFilename);
-    file.copy(backupFilename);
+    // Only writes anything if we haven't seen this exact file before
+    if (makeBackup) {
+        BackupStore backups(file.fileName());
+        if (!backups.store(file.rawContents())) {
+            qWarning() << "Failed to back up" << file.fileName() << "to" << backups.directory();
+        }
+    }
+    file.close();
 
     emit nameChanged(characterName());
     emit xpChanged(xp());
@@ -384,253 +139,188 @@ bool Savegame::load(const QString &filePath)
     return true;
 }
 
-InventoryItem Savegame::parseItem(const std::string &obfuscatedSerial)
-{
-    QByteArray serial = deobfuscateItem(QByteArray::fromStdString(obfuscatedSerial));
-    if (serial.isEmpty()) {
-        qWarning() << "Couldn't deobfuscate";
-        return {};
-    }
-
-    BitParser bits(serial);
-    if (bits.eat(8) != 128) {
-        qWarning() << "Invalid start";
-        QMessageBox::warning(nullptr, "Invalid file", tr("Item data has wrong start."));
-        return {};
-    }
-
-    InventoryItem item;
-    item.version = bits.eat(7);
-    item.seed = qFromBigEndian<int32_t>(obfuscatedSerial.data() + 1);
-    if (item.version > m_maxItemVersion) {
-        QMessageBox::warning(nullptr, "Invalid file", tr("Item version is too high (%1, we only support %2").arg(item.version, m_maxItemVersion));
-        item.remainingBits = bits.m_bits;
-        return item;
-    }
-    item.balance = getAspect("InventoryBalanceData", item.version, &bits);
-    if (!item.balance.isValid()) {
-        QMessageBox::warning(nullptr, "Invalid file", tr("Invalid item balance"));
-        qWarning() << "Invalid item balance";
-        item.remainingBits = bits.m_bits;
-        return item;
-    }
-
-    item.objectShortName = item.balance.val.split('/', QString::SkipEmptyParts).last().split('.', QString::SkipEmptyParts).last();
-    item.name = ItemData::englishName(item.objectShortName);
-
-    item.data = getAspect("InventoryData", item.version, &bits); // these seem wrong
-    if (!item.data.isValid()) {
-        QMessageBox::warning(nullptr, "Invalid file", tr("Invalid item data"));
-        item.remainingBits = bits.m_bits;
-        return item;
-    }
-    item.manufacturer = getAspect("ManufacturerData", item.version, &bits);
-    if (!item.manufacturer.isValid()) {
-        QMessageBox::warning(nullptr, "Invalid file", tr("Invalid item manufacturer"));
-        item.remainingBits = bits.m_bits;
-        return item;
-    }
-    item.level = bits.eat(7);
-    item.numberOfParts = bits.eat(6);
-
-    item.partsCategory = ItemData::partCategory(item.balance.val.toLower());
-    bool itemFailed = false;
-    if (!item.partsCategory.isEmpty()) {
-        for (int partIndex = 0; partIndex < item.numberOfParts; partIndex++) {
-            InventoryItem::Aspect part = getAspect(item.partsCategory, item.version, &bits);
-            if (!part.isValid()) {
-                qWarning() << "Invalid" << item.balance.val << item.partsCategory;
-                //                    QMessageBox::warning(nullptr, "Invalid file", tr("Failed to get item part %1 for item %2.").arg(partIndex).arg(item.name));
-                itemFailed = true;
-                break;
-                //                    return false;
-            }
-            item.parts.append(part);
-        }
-    } else {
-        qWarning() << "Item not in parts database:" << item.balance.val;
-        itemFailed = true;
-    }
-
-    if (!itemFailed) {
-        const int genericPartsCount = bits.eat(4);
-        for (int partIndex = 0; partIndex < genericPartsCount; partIndex++) {
-            InventoryItem::Aspect genericPart = getAspect("InventoryGenericPartData", item.version, &bits);
-            if (!genericPart.isValid()) {
-                qWarning() << "Invalid generic item part number" << partIndex;
-                itemFailed = true;
-                break;
-            }
-            item.genericParts.append(genericPart);
-            qDebug() << "Got generic part" << genericPart.index;
-        }
-    }
+const InventoryItem &Savegame::inventoryItem(const int index)
+{
+    ensureFullyDecoded(index);
+    return m_items[index];
+}
 
-    if (!itemFailed) {
-        const int itemWearCount = bits.eat(8);
-        for (int index = 0; index<itemWearCount; index++) {
-            item.itemWearMaybe.append(bits.eat(8));
-        }
-        item.numCustom = bits.eat(4);
-        if (item.numCustom > 0) {
-            qWarning() << "We don't know what num custom is, we have" << item.numCustom;
-        }
+void Savegame::ensureFullyDecoded(const int index)
+{
+    if (m_items[index].fullyDecoded) {
+        return;
     }
 
-    if (!itemFailed) {
-        if (bits.m_bits.count() > 7 || bits.m_bits.count('1') > 0) {
-            qWarning() << "There should be only zero padding left, we have" << bits.m_bits;
+    DecodedItem decoded;
+    decoded.item = ItemCodec::decode(serialForItem(index), &decoded.diagnostic);
+    applyFullyDecoded(index, decoded);
+}
+
+void Savegame::decodeAllItems()
+{
+    QVector<int> pending;
+    QVector<const std::string*> serials;
+    for (int index=0; index<m_items.count(); index++) {
+        if (!m_items[index].fullyDecoded) {
+            pending.append(index);
+            serials.append(&serialForItem(index));
         }
     }
 
-    item.remainingBits = bits.m_bits;
-
-    return item;
+    const QVector<DecodedItem> decodedItems = ItemCodec::decodeAll(serials);
+    for (int i=0; i<pending.count(); i++) {
+        applyFullyDecoded(pending[i], decodedItems[i]);
+    }
 }
 
-std::string Savegame::serializeItem(const InventoryItem &item)
+const std::string &Savegame::serialForItem(const int index) const
 {
-    BitParser bits;
-    bits.put(128, 8);
-    bits.put(item.version, 7);
-    putAspect(item.balance,"InventoryBalanceData", item.version, &bits);
-    putAspect(item.data,"InventoryData", item.version, &bits);
-    putAspect(item.manufacturer,"ManufacturerData", item.version, &bits);
-    bits.put(item.level, 7);
-    bits.put(item.parts.count(), 6);
+    return m_character->inventory_items(m_itemSerialIndices[index]).item_serial_number();
+}
 
-    QString itemPartCategory = ItemData::partCategory(item.balance.val.toLower());
-    for (const InventoryItem::Aspect &part : item.parts) {
-        putAspect(part, itemPartCategory, item.version, &bits);
-    }
+void Savegame::applyFullyDecoded(const int index, const DecodedItem &decoded)
+{
+    Diagnostic diagnostic = decoded.diagnostic;
+    diagnostic.itemIndex = m_itemSerialIndices[index];
 
-    bits.put(item.genericParts.count(), 4);
-    for (const InventoryItem::Aspect &genericPart : item.genericParts) {
-        putAspect(genericPart, itemPartCategory, item.version, &bits);
-    }
+    if (!decoded.item.isValid()) {
+        if (!diagnostic.isError()) { // decoded, but something we don't handle yet
+            diagnostic.error = DecodeError::InvalidItem;
+            diagnostic.message = tr("Unsupported item %1").arg(m_items[index].name);
+        }
+        qWarning() << "Invalid item:" << diagnostic.itemIndex << diagnostic.message;
+        m_report.add(diagnostic);
 
-    bits.put(item.itemWearMaybe.count(), 8);
-    for (const uint8_t itemWear : item.itemWearMaybe) {
-        bits.put(itemWear, 8);
+        // Keep what we got from the header, but don't try again
+        m_items[index].fullyDecoded = true;
+        m_items[index].writable = false;
+        return;
     }
 
-    bits.m_bits.append(item.remainingBits);
-    return obfuscateItem(bits.toBinaryData(), item.seed).toStdString();
+    m_report.add(diagnostic);
+    m_items[index] = decoded.item;
 }
 
-InventoryItem::Aspect Savegame::getAspect(const QString &category, const int requiredVersion, BitParser *bits)
+bool Savegame::save(const QString filePath)
 {
-    InventoryItem::Aspect aspect;
-    aspect.bits = ItemData::requiredBits(category, requiredVersion);
-    if (aspect.bits <= 0) {
-        qWarning() << "Invalid aspect";
-        return {};
-    }
-    aspect.index = bits->eat(aspect.bits);
-    if (aspect.index < 0) {
-        qWarning() << "Invalid index" << aspect.index;
-        return {};
-    }
-    if (aspect.index == 0) { // it is for some weird reason 1-indexed
-        qWarning() << "Zero index for" << category;
-        return {};
-    }
-    aspect.val = ItemData::getItemAsset(category, aspect.index - 1);
-    if (aspect.val.isEmpty()) {
-        qWarning() << "Can't find val for" << category << aspect.index;
-        return {};
-    }
+    commitItemEdits();
 
-    return aspect;
-}
+    const QString error = GvasFile::write(filePath, m_header, *m_character);
+    if (!error.isEmpty()) {
+        QMessageBox::warning(nullptr, "Failed to save", error);
+        return false;
+    }
 
-void Savegame::putAspect(const InventoryItem::Aspect &aspect, const QString &category, const int requiredVersion, BitParser *bits)
-{
-    bits->put(aspect.index, ItemData::requiredBits(category, requiredVersion));
+    return true;
 }
 
-bool Savegame::save(const QString filePath) const
+bool Savegame::canEditItem(const int index)
 {
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly)) {
-        QMessageBox::warning(nullptr, "Failed to open file", file.errorString());
+    if (index < 0 || index >= m_items.count()) {
+        qWarning() << "item index out of range" << index;
         return false;
     }
-    file.write("GVAS");
-    bool couldWriteHeader =
-            writeInt(m_header.savegameVersion, &file) &&
-            writeInt(m_header.packageVersion, &file) &&
-            writeInt(m_header.engineMajorVersion, &file) &&
-            writeInt(m_header.engineMinorVersion, &file) &&
-            writeInt(m_header.enginePatchVersion, &file) &&
-            writeInt(m_header.engineBuild, &file) &&
-            writeString(m_header.buildId, &file) &&
-            writeInt(m_header.customFormatVersion, &file) &&
-            writeInt(m_header.customFormatCount, &file);
-
-    if (!couldWriteHeader) {
-        QMessageBox::warning(nullptr, "Invalid header", "Failed to write header to file:\n" + file.errorString());
+    ensureFullyDecoded(index);
+    if (!m_items[index].isValid()) {
+        qWarning() << "Can't edit item that failed to decode" << index;
         return false;
     }
-
-    for (const Header::CustomFormat &format : m_header.customFormats) {
-        file.write(format.id.toRfc4122());
-        writeInt(format.entry, &file);
-    }
-    writeString(m_header.savegameType, &file);
-
-    QByteArray data = QByteArray::fromStdString(m_character->SerializeAsString());
-
-    char *dataRaw = data.data();
-    for (int i=0; i<data.size(); i++) {
-        // I want a prize for ugly code
-        // Premature optimization^Wobfuscation (it's probably not faster than doing it the pretty way)
-        dataRaw[i] ^= (i < int(sizeof(obfuscation::prefixMask)) ? obfuscation::prefixMask[i] : dataRaw[i - sizeof(obfuscation::prefixMask)])
-            ^ obfuscation::xorMask[i % sizeof(obfuscation::xorMask)];
-    }
-    qDebug() << file.pos();
-
-    writeInt(data.length(), &file);
-    file.write(data);
-
     return true;
 }
 
+// Edits only change m_items, the serials in the savegame are what was last
+// committed, so reverting is just decoding them again.
 void Savegame::addInventoryItemPart(const int index, const InventoryItem::Aspect &part)
 {
-    qDebug() << "Adding" << part.val;
+    qDebug() << "Adding" << StringPool::string(part.val);
+    if (!canEditItem(index)) {
+        return;
+    }
 
     m_items[index].parts.append(part);
-    m_character->mutable_inventory_items(index)->set_item_serial_number(serializeItem(m_items[index]));
+    m_items[index].markChanged();
+    m_dirtyItems.insert(index);
 }
 
 void Savegame::removeInventoryItemPart(const int index, const QString partId)
 {
     qDebug() << "Trying to find" << partId;
+    if (!canEditItem(index)) {
+        return;
+    }
     QMutableVectorIterator<InventoryItem::Aspect> it(m_items[index].parts);
     while(it.hasNext()) {
-        if (it.next().val.endsWith(partId)) {
-            qDebug() << " >>>>>>>>>>>>>>>>>>> Removing" << it.value().val;
+        if (StringPool::string(it.next().val).endsWith(partId)) {
+            qDebug() << " >>>>>>>>>>>>>>>>>>> Removing" << StringPool::string(it.value().val);
             it.remove();
         }
     }
 //    m_items[index].parts.remove(partIndex);
-    m_character->mutable_inventory_items(index)->set_item_serial_number(serializeItem(m_items[index]));
+    m_items[index].markChanged();
+    m_dirtyItems.insert(index);
 }
 
-void Savegame::setItemLevel(const int index, const int newLevel)
+void Savegame::addInventoryItemGenericPart(const int index, const InventoryItem::Aspect &part)
 {
-    if (index < 0 || index >= m_items.count()) {
-        qWarning() << "item index out of range" << index;
+    if (!canEditItem(index)) {
+        return;
+    }
+
+    m_items[index].genericParts.append(part);
+    m_items[index].markChanged();
+    m_dirtyItems.insert(index);
+}
+
+void Savegame::removeInventoryItemGenericPart(const int index, const QString partId)
+{
+    if (!canEditItem(index)) {
         return;
     }
+    QMutableVectorIterator<InventoryItem::Aspect> it(m_items[index].genericParts);
+    while(it.hasNext()) {
+        if (StringPool::string(it.next().val).endsWith(partId)) {
+            it.remove();
+        }
+    }
+    m_items[index].markChanged();
+    m_dirtyItems.insert(index);
+}
+
+void Savegame::setItemLevel(const int index, const int newLevel)
+{
     if (newLevel < Constants::minLevel || newLevel > Constants::maxLevel) {
         qWarning() << "Level out of range" << newLevel;
         return;
     }
+    if (!canEditItem(index)) {
+        return;
+    }
     m_items[index].level = newLevel;
+    m_items[index].markChanged();
+    m_dirtyItems.insert(index);
+}
 
-    m_character->mutable_inventory_items(index)->set_item_serial_number(serializeItem(m_items[index]));
+int Savegame::commitItemEdits()
+{
+    for (const int index : qAsConst(m_dirtyItems)) {
+        InventoryItem &item = m_items[index];
+        item.serial = ItemCodec::serialize(item);
+        item.serialGeneration = item.generation;
+        m_character->mutable_inventory_items(m_itemSerialIndices[index])->set_item_serial_number(item.serial);
+    }
+    const int count = m_dirtyItems.count();
+    m_dirtyItems.clear();
+    return count;
+}
+
+void Savegame::revertItemEdits()
+{
+    for (const int index : qAsConst(m_dirtyItems)) {
+        Diagnostic diagnostic;
+        m_items[index] = ItemCodec::decode(serialForItem(index), &diagnostic);
+    }
+    m_dirtyItems.clear();
+    emit itemsChanged();
 }
 
 int Savegame::ammoAmount(const QString &name) const
@@ -818,18 +508,7 @@ void Savegame::setXp(const int newXp)
 
 int Savegame::level() const
 {
-    const int currentXp = xp();
-    int level = 0;
-    for (const int requiredXp : Constants::requiredXp) {
-        if (currentXp >= requiredXp) {
-            level++;
-        } else {
-            return level;
-        }
-    }
-
-    qWarning() << "Invalid amount of xp" << currentXp << ", can't get level";
-    return level;
+    return Constants::levelFromXp(xp());
 }
 
 void Savegame::setLevel(const int newLevel)
@@ -4,10 +4,13 @@
 #include "Constants.h"
 #include "ItemData.h"
 #include "InventoryItem.h"
+#include "DecodeReport.h"
+#include "GvasFile.h"
 
 #include <memory>
 #include <QString>
 #include <QVector>
+#include <QSet>
 #include <QUuid>
 #include <QObject>
 #include <QJsonObject>
@@ -15,53 +18,51 @@
 namespace OakSave {
 class Character;
 }
+namespace google {
+namespace protobuf {
+class Arena;
+}
+}
 
-class QIODevice;
-struct BitParser;
+struct DecodedItem;
 
 class Savegame : public QObject
 {
     Q_OBJECT
 
-    struct Header {
-        uint32_t savegameVersion;
-        uint32_t packageVersion;
-
-        uint16_t engineMajorVersion;
-        uint16_t engineMinorVersion;
-        uint16_t enginePatchVersion;
-
-        uint32_t engineBuild;
-        QString buildId;
-
-        uint32_t customFormatVersion;
-        uint32_t customFormatCount;
-
-        struct CustomFormat {
-            QUuid id;
-            int entry = 0;
-        };
-        QVector<CustomFormat> customFormats;
-
-        QString savegameType;
-
-        int32_t dataLength;
-    } m_header{};
-
 public:
     Savegame(QObject *parent);
     virtual ~Savegame();
 
-    bool load(const QString &filePath);
-    bool save(const QString filePath) const;
+    // Only backs it up (see BackupStore) if asked, batch mode shouldn't write anything
+    bool load(const QString &filePath, const bool makeBackup = false);
+    // Commits any pending item edits first
+    bool save(const QString filePath);
 
     const QVector<InventoryItem> &items() { return m_items; }
     int inventoryItemsCount() const { return m_items.count(); }
-    const InventoryItem &inventoryItem(const int index) { return m_items[index]; }
+    int failedItemsCount() const { return m_report.failedItemsCount(); }
+
+    // What went wrong in the last load()
+    const DecodeReport &decodeReport() const { return m_report; }
+    // Decodes the rest of the item the first time, items() only has the header (name, level etc.)
+    const InventoryItem &inventoryItem(const int index);
+    void decodeAllItems();
+
+    // Item edits are only applied to items(), the items are encoded back into
+    // the savegame once each in commitItemEdits(), however many edits there were
     void addInventoryItemPart(const int index, const InventoryItem::Aspect &part);
     void removeInventoryItemPart(const int index, const QString partId);
+    void addInventoryItemGenericPart(const int index, const InventoryItem::Aspect &part);
+    void removeInventoryItemGenericPart(const int index, const QString partId);
     void setItemLevel(const int index, const int newLevel);
 
+    bool hasPendingItemEdits() const { return !m_dirtyItems.isEmpty(); }
+    // Returns how many items were encoded
+    int commitItemEdits();
+    // Goes back to the items as they were at the last commit
+    void revertItemEdits();
+
     int ammoAmount(const QString &name) const;
     void setAmmoAmount(const QString &name, const int amount);
 
@@ -110,18 +111,28 @@ signals:
 
 
 private:
-    InventoryItem parseItem(const std::string &obfuscatedSerial);
-    std::string serializeItem(const InventoryItem &item);
-
-    InventoryItem::Aspect getAspect(const QString &category, const int requiredVersion, BitParser *bits);
-    void putAspect(const InventoryItem::Aspect &aspect, const QString &category, const int requiredVersion, BitParser *bits);
+    const std::string &serialForItem(const int index) const;
+    void ensureFullyDecoded(const int index);
+    void applyFullyDecoded(const int index, const DecodedItem &decoded);
+    bool canEditItem(const int index);
 
     int currencyAmount(const Constants::Currency currenct) const;
     void setCurrency(const Constants::Currency currency, const int amount);
-    std::unique_ptr<OakSave::Character> m_character;
+    void resetArena(const size_t expectedSize);
+
+    // Everything protobuf parses lives in the arena, so it all goes away in
+    // one go, and the first block is reused for the next load
+    std::unique_ptr<char[]> m_arenaBlock;
+    size_t m_arenaBlockSize = 0;
+    std::unique_ptr<google::protobuf::Arena> m_arena;
+    OakSave::Character *m_character = nullptr; // owned by m_arena
+
+    GvasFile::Header m_header{};
 
     QVector<InventoryItem> m_items;
-    int m_maxItemVersion = 1000; // todo
+    QVector<int> m_itemSerialIndices; // Items that fail to decode are skipped, so we need to know where they are in the savegame
+    QSet<int> m_dirtyItems; // edited, but not encoded yet
+    DecodeReport m_report;
 };
 
 
@@ -0,0 +1,90 @@
+#include "StringPool.h"
+
+#include <QDebug>
+
+StringPool::StringPool() :
+    m_count(1)
+{
+    for (std::atomic<QString*> &chunk : m_chunks) {
+        chunk.store(nullptr, std::memory_order_relaxed);
+    }
+
+    // So id 0 is the empty string
+    m_chunks[0].store(new QString[chunkSize], std::memory_order_release);
+}
+
+StringPool::~StringPool()
+{
+    for (std::atomic<QString*> &chunk : m_chunks) {
+        delete[] chunk.load(std::memory_order_relaxed);
+    }
+}
+
+StringPool *StringPool::instance()
+{
+    static StringPool inst;
+    return &inst;
+}
+
+// Strings from the item database point straight into it (fromRawData), so
+// interning those doesn't copy anything, the database is never unloaded.
+StringId StringPool::intern(const QString &string)
+{
+    if (string.isEmpty()) {
+        return null;
+    }
+
+    StringPool *me = instance();
+    QMutexLocker locker(&me->m_mutex);
+
+    QHash<QString, StringId>::const_iterator it = me->m_ids.constFind(string);
+    if (it != me->m_ids.constEnd()) {
+        return *it;
+    }
+
+    const uint32_t id = me->m_count.load(std::memory_order_relaxed);
+    const uint32_t chunkIndex = id >> chunkBits;
+    if (chunkIndex >= maxChunks) {
+        qWarning() << "Too many strings in the pool, can't add" << string;
+        return null;
+    }
+
+    QString *chunk = me->m_chunks[chunkIndex].load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new QString[chunkSize];
+        me->m_chunks[chunkIndex].store(chunk, std::memory_order_release);
+    }
+    chunk[id & (chunkSize - 1)] = string;
+
+    // Only visible to string() after it is written
+    me->m_count.store(id + 1, std::memory_order_release);
+    me->m_ids.insert(string, id);
+
+    return id;
+}
+
+StringId StringPool::find(const QString &string)
+{
+    if (string.isEmpty()) {
+        return null;
+    }
+
+    StringPool *me = instance();
+    QMutexLocker locker(&me->m_mutex);
+    return me->m_ids.value(string, null);
+}
+
+const QString &StringPool::string(const StringId id)
+{
+    const StringPool *me = instance();
+    if (id >= me->m_count.load(std::memory_order_acquire)) {
+        qWarning() << "Invalid string id" << id;
+        return me->m_chunks[0].load(std::memory_order_acquire)[0];
+    }
+    return me->m_chunks[id >> chunkBits].load(std::memory_order_acquire)[id & (chunkSize - 1)];
+}
+
+int StringPool::count()
+{
+    return int(instance()->m_count.load(std::memory_order_acquire));
+}
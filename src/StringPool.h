@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+
+#include <atomic>
+#include <cstdint>
+
+// Small integer id for an interned string, 0 is the empty string.
+using StringId = uint32_t;
+
+// Every distinct string (asset paths, part ids, categories etc.) is only
+// stored once, and the item tables and decoded items keep the id instead of
+// their own QString. So comparing them is comparing ints, and we only turn
+// them back into strings when showing them to someone.
+class StringPool
+{
+public:
+    static constexpr StringId null = 0;
+
+    // The same string always gets the same id, safe to call from any thread
+    static StringId intern(const QString &string);
+
+    // Doesn't add it, returns null if it has never been interned
+    static StringId find(const QString &string);
+
+    // Lock free, the strings never move or go away once they're added.
+    // Invalid ids give an empty string.
+    static const QString &string(const StringId id);
+
+    static int count();
+
+private:
+    StringPool();
+    ~StringPool();
+    static StringPool *instance();
+
+    static constexpr int chunkBits = 12;
+    static constexpr uint32_t chunkSize = 1 << chunkBits;
+    static constexpr uint32_t maxChunks = 1024; // 4M strings, we have less than 100k
+
+    QMutex m_mutex; // for adding, and m_ids
+    QHash<QString, StringId> m_ids;
+
+    // Chunks so the existing ones never have to move when we add more
+    std::atomic<QString*> m_chunks[maxChunks];
+    std::atomic<uint32_t> m_count;
+};
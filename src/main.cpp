@@ -1,10 +1,21 @@
 #include "MainWindow.h"
+#include "BatchMode.h"
+#include "ItemData.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    if (BatchMode::isRequested(argc, argv)) {
+        QCoreApplication a(argc, argv);
+        return BatchMode::run(a.arguments());
+    }
+
     QApplication a(argc, argv);
+
+    // So it is hopefully ready before anyone opens a file
+    ItemData::warmUp();
+
     MainWindow w;
     if (argc > 1) {
         w.setFilePath(QString::fromLocal8Bit(argv[1]));
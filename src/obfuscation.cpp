@@ -0,0 +1,242 @@
+#include "obfuscation.h"
+
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define HAVE_SSE2
+#if defined(__GNUC__) // gcc and clang can build the avx2 version without -mavx2 for everything
+#define HAVE_AVX2_DISPATCH
+#endif
+#endif
+
+namespace obfuscation {
+
+namespace {
+
+constexpr size_t blockSize = sizeof(xorMask);
+static_assert(sizeof(prefixMask) == blockSize, "Masks need to be the same size");
+
+// Backwards so it works in place, we need the obfuscated byte from one block back
+void deobfuscateBytes(const char *input, char *output, const size_t start, const size_t end)
+{
+    for (size_t i = end; i-- > start;) {
+        const uint8_t previous = i < blockSize ? prefixMask[i] : uint8_t(input[i - blockSize]);
+        output[i] = char(input[i] ^ previous ^ xorMask[i % blockSize]);
+    }
+}
+
+// Forwards, we need the already obfuscated byte from one block back
+void obfuscateBytes(char *data, const size_t start, const size_t end)
+{
+    for (size_t i = start; i < end; i++) {
+        const uint8_t previous = i < blockSize ? prefixMask[i] : uint8_t(data[i - blockSize]);
+        data[i] = char(data[i] ^ previous ^ xorMask[i % blockSize]);
+    }
+}
+
+void deobfuscateScalar(const char *input, char *output, const size_t size)
+{
+    deobfuscateBytes(input, output, 0, size);
+}
+
+void obfuscateScalar(char *data, const size_t size)
+{
+    obfuscateBytes(data, 0, size);
+}
+
+// Each block only depends on the block before it, so we just keep the
+// previous block in registers. The bytes after the last full block are done
+// first when deobfuscating, before the last full block might get overwritten.
+
+#ifdef HAVE_SSE2
+void deobfuscateSse2(const char *input, char *output, const size_t size)
+{
+    const size_t blocks = size / blockSize;
+    deobfuscateBytes(input, output, blocks * blockSize, size);
+
+    const __m128i xorLow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xorMask));
+    const __m128i xorHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xorMask + 16));
+    __m128i previousLow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prefixMask));
+    __m128i previousHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prefixMask + 16));
+
+    for (size_t block = 0; block < blocks; block++) {
+        const char *in = input + block * blockSize;
+        char *out = output + block * blockSize;
+
+        const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_xor_si128(low, _mm_xor_si128(previousLow, xorLow)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_xor_si128(high, _mm_xor_si128(previousHigh, xorHigh)));
+        previousLow = low;
+        previousHigh = high;
+    }
+}
+
+void obfuscateSse2(char *data, const size_t size)
+{
+    const size_t blocks = size / blockSize;
+
+    const __m128i xorLow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xorMask));
+    const __m128i xorHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xorMask + 16));
+    __m128i previousLow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prefixMask));
+    __m128i previousHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prefixMask + 16));
+
+    for (size_t block = 0; block < blocks; block++) {
+        char *out = data + block * blockSize;
+
+        previousLow = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(out)), _mm_xor_si128(previousLow, xorLow));
+        previousHigh = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(out + 16)), _mm_xor_si128(previousHigh, xorHigh));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), previousLow);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), previousHigh);
+    }
+
+    obfuscateBytes(data, blocks * blockSize, size);
+}
+#endif // HAVE_SSE2
+
+#ifdef HAVE_AVX2_DISPATCH
+__attribute__((target("avx2")))
+void deobfuscateAvx2(const char *input, char *output, const size_t size)
+{
+    const size_t blocks = size / blockSize;
+    deobfuscateBytes(input, output, blocks * blockSize, size);
+
+    const __m256i xorBlock = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xorMask));
+    __m256i previous = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prefixMask));
+
+    for (size_t block = 0; block < blocks; block++) {
+        const __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + block * blockSize));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + block * blockSize), _mm256_xor_si256(current, _mm256_xor_si256(previous, xorBlock)));
+        previous = current;
+    }
+}
+
+__attribute__((target("avx2")))
+void obfuscateAvx2(char *data, const size_t size)
+{
+    const size_t blocks = size / blockSize;
+
+    const __m256i xorBlock = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xorMask));
+    __m256i previous = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prefixMask));
+
+    for (size_t block = 0; block < blocks; block++) {
+        __m256i *out = reinterpret_cast<__m256i*>(data + block * blockSize);
+        previous = _mm256_xor_si256(_mm256_loadu_si256(out), _mm256_xor_si256(previous, xorBlock));
+        _mm256_storeu_si256(out, previous);
+    }
+
+    obfuscateBytes(data, blocks * blockSize, size);
+}
+#endif // HAVE_AVX2_DISPATCH
+
+struct Kernels {
+    void (*deobfuscate)(const char *, char *, size_t);
+    void (*obfuscate)(char *, size_t);
+};
+
+Kernels pickKernels()
+{
+#ifdef HAVE_AVX2_DISPATCH
+    if (__builtin_cpu_supports("avx2")) {
+        return { deobfuscateAvx2, obfuscateAvx2 };
+    }
+#endif
+#ifdef HAVE_SSE2
+    return { deobfuscateSse2, obfuscateSse2 };
+#else
+    return { deobfuscateScalar, obfuscateScalar };
+#endif
+}
+
+const Kernels &kernels()
+{
+    static const Kernels picked = pickKernels();
+    return picked;
+}
+
+} // namespace
+
+void deobfuscateBody(const char *input, char *output, const size_t size)
+{
+    kernels().deobfuscate(input, output, size);
+}
+
+void obfuscateBody(char *data, const size_t size)
+{
+    kernels().obfuscate(data, size);
+}
+
+// The way it was done before, so there's something simple to compare with
+static void referenceDeobfuscate(char *data, const int size)
+{
+    for (int i=size - 1; i >= 0; i--) {
+        data[i] ^= (i < int(sizeof(prefixMask)) ? prefixMask[i] : data[i - sizeof(prefixMask)])
+            ^ xorMask[i % sizeof(xorMask)];
+    }
+}
+
+static void referenceObfuscate(char *data, const int size)
+{
+    for (int i=0; i<size; i++) {
+        data[i] ^= (i < int(sizeof(prefixMask)) ? prefixMask[i] : data[i - sizeof(prefixMask)])
+            ^ xorMask[i % sizeof(xorMask)];
+    }
+}
+
+const char *checkBodyKernels()
+{
+    struct NamedKernels {
+        const char *name;
+        Kernels kernels;
+        bool available;
+    };
+    const NamedKernels all[] = {
+        { "scalar", { deobfuscateScalar, obfuscateScalar }, true },
+#ifdef HAVE_SSE2
+        { "SSE2", { deobfuscateSse2, obfuscateSse2 }, true },
+#endif
+#ifdef HAVE_AVX2_DISPATCH
+        { "AVX2", { deobfuscateAvx2, obfuscateAvx2 }, bool(__builtin_cpu_supports("avx2")) },
+#endif
+    };
+
+    // Odd sizes to hit all the leftover bytes after the last full block
+    for (const size_t size : { 0, 1, 31, 32, 33, 63, 64, 65, 100, 4096 + 17 }) {
+        std::vector<char> original(size);
+        uint32_t state = 1337 + uint32_t(size);
+        for (char &c : original) {
+            state = state * 1103515245 + 12345;
+            c = char(state >> 16);
+        }
+
+        std::vector<char> deobfuscated = original;
+        referenceDeobfuscate(deobfuscated.data(), int(size));
+        std::vector<char> obfuscated = original;
+        referenceObfuscate(obfuscated.data(), int(size));
+
+        for (const NamedKernels &kernel : all) {
+            if (!kernel.available) {
+                continue;
+            }
+
+            std::vector<char> outOfPlace(size);
+            kernel.kernels.deobfuscate(original.data(), outOfPlace.data(), size);
+            std::vector<char> inPlace = original;
+            kernel.kernels.deobfuscate(inPlace.data(), inPlace.data(), size);
+            if (outOfPlace != deobfuscated || inPlace != deobfuscated) {
+                return kernel.name;
+            }
+
+            inPlace = original;
+            kernel.kernels.obfuscate(inPlace.data(), size);
+            if (inPlace != obfuscated) {
+                return kernel.name;
+            }
+        }
+    }
+    return nullptr;
+}
+
+} // namespace obfuscation
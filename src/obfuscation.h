@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 
 namespace obfuscation {
     constexpr uint8_t prefixMask[] = {
@@ -21,4 +22,16 @@ namespace obfuscation {
 
     constexpr uint64_t itemKey = 0x10A860C1;
     constexpr uint64_t itemMask = 0xFFFFFFFB;
+
+    // The savegame body, every byte is xored with the byte 32 bytes before it
+    // (or the prefix mask for the first 32 bytes) and the xor mask.
+    // Picks SSE2/AVX2 versions at runtime if available.
+    // input and output can be the same buffer.
+    void deobfuscateBody(const char *input, char *output, const size_t size);
+    void obfuscateBody(char *data, const size_t size);
+
+    // Runs every version this CPU can run (plain, SSE2, AVX2) against the
+    // original byte by byte loops, in place and not. Returns the name of the
+    // first one that gets it wrong, or nullptr if they're all fine.
+    const char *checkBodyKernels();
 }
@@ -0,0 +1,67 @@
+// Checks the builds BuildEnumerator comes up with against
+// PartConstraints::check(), for all the balances in the built in database.
+
+#include "BuildEnumerator.h"
+#include "ItemData.h"
+
+#include <cstdio>
+
+// Walking all of them takes too long for the big ones, counting is enough there
+static const quint64 maxWalked = 100000;
+
+int main()
+{
+    ItemData::ready().waitForFinished();
+    if (!ItemData::isValid()) {
+        fprintf(stderr, "Failed to load item database\n");
+        return 1;
+    }
+
+    int failures = 0;
+    for (const QString &balance : ItemData::balancesWithParts()) {
+        const PartConstraints &constraints = ItemData::partConstraints(balance);
+        BuildEnumerator enumerator(&constraints);
+
+        // Everything the game drops passes check(), so there has to be at least one
+        const quint64 count = enumerator.count();
+        if (count == 0) {
+            fprintf(stderr, "%s has no valid builds\n", qPrintable(balance));
+            failures++;
+            continue;
+        }
+        if (count > maxWalked) {
+            continue;
+        }
+
+        quint64 walked = 0;
+        enumerator.forEach([&](const QVector<int> &parts) {
+            walked++;
+            QVector<StringId> partIds;
+            for (const int part : parts) {
+                partIds.append(constraints.partId(part));
+            }
+            if (!constraints.check(partIds).isEmpty()) {
+                fprintf(stderr, "%s has an invalid build\n", qPrintable(balance));
+                failures++;
+                return false;
+            }
+            return true;
+        });
+        if (walked != count) {
+            fprintf(stderr, "%s counted %llu builds, but walked %llu\n", qPrintable(balance), count, walked);
+            failures++;
+        }
+    }
+
+    // Its only BARREL ACCESSORY part depends on a part it can't have, which made it count 0 once
+    if (BuildEnumerator(&ItemData::partConstraints("Balance_SG_JAK_Hellwalker")).count() == 0) {
+        fprintf(stderr, "Balance_SG_JAK_Hellwalker has no valid builds\n");
+        failures++;
+    }
+
+    if (failures > 0) {
+        return 1;
+    }
+    printf("All builds are valid\n");
+    return 0;
+}
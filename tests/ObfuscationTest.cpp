@@ -0,0 +1,17 @@
+// Checks that the vectorized savegame body de/obfuscation gives exactly the
+// same bytes as the plain loops, on whatever this runs on.
+
+#include "obfuscation.h"
+
+#include <cstdio>
+
+int main()
+{
+    const char *failed = obfuscation::checkBodyKernels();
+    if (failed) {
+        fprintf(stderr, "%s de/obfuscation doesn't match the plain loops\n", failed);
+        return 1;
+    }
+    printf("All body de/obfuscation kernels match\n");
+    return 0;
+}
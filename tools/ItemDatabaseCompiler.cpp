@@ -0,0 +1,424 @@
+// Builds the item database blob (see src/ItemDatabaseFormat.h) from the json
+// and tsv files in data/, run by cmake at build time.
+//
+// Usage: ItemDatabaseCompiler <data directory> <output file>
+
+#include "ItemDatabaseFormat.h"
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QtEndian>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static_assert(Q_BYTE_ORDER == Q_LITTLE_ENDIAN, "The structs are written as is, so we need to be little endian");
+
+using namespace itemdb;
+
+static void fail(const QString &message)
+{
+    fprintf(stderr, "ItemDatabaseCompiler: %s\n", qPrintable(message));
+    exit(1);
+}
+
+static QByteArray readFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fail("Failed to open " + path + ": " + file.errorString());
+    }
+    return file.readAll();
+}
+
+static QJsonObject readJson(const QString &path)
+{
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(readFile(path), &error);
+    if (document.isNull()) {
+        fail("Failed to parse " + path + ": " + error.errorString());
+    }
+    return document.object();
+}
+
+// Same strings are only stored once, there's a lot of repetition in the parts files
+struct StringTable
+{
+    StringRef add(const QString &string) {
+        QHash<QString, StringRef>::const_iterator it = m_refs.constFind(string);
+        if (it != m_refs.constEnd()) {
+            return *it;
+        }
+        StringRef ref;
+        ref.offset = uint32_t(m_data.size() / sizeof(char16_t));
+        ref.length = uint32_t(string.size());
+        m_data.append(reinterpret_cast<const char*>(string.utf16()), string.size() * int(sizeof(char16_t)));
+        m_refs.insert(string, ref);
+        return ref;
+    }
+
+    QByteArray m_data;
+    QHash<QString, StringRef> m_refs;
+};
+
+template <typename T>
+static void append(QByteArray *section, const T &record)
+{
+    section->append(reinterpret_cast<const char*>(&record), sizeof(T));
+}
+
+struct Compiler
+{
+    void loadNames(const QString &dataDir);
+    void loadInventorySerials(const QString &dataDir);
+    void loadWeaponParts(const QString &dataDir);
+    void loadPartsForOther(const QString &dataDir, const QString &type);
+    void loadWeaponPartDescriptions(const QString &filename);
+    void loadShieldPartDescriptions(const QString &dataDir);
+    void loadGrenadePartDescriptions(const QString &dataDir);
+    void loadClassModDescriptions(const QString &dataDir, const QString &characterClass);
+    void loadItemInfos(const QString &dataDir);
+
+    QByteArray build();
+
+    StringRef addList(const QStringList &list);
+    void addPart(const QString &manufacturer, const QString &itemType, const QStringList &line, const int firstColumn);
+    void addDescription(const QString &id, const QString &positives, const QString &negatives, const QString &effects, const QString &naming);
+
+    StringTable strings;
+    QByteArray sections[int(Section::Count)];
+
+    QSet<QString> descriptionIds;
+};
+
+void Compiler::loadNames(const QString &dataDir)
+{
+    const QJsonObject names = readJson(dataDir + "/english-names.json");
+    for (QJsonObject::const_iterator it = names.constBegin(); it != names.constEnd(); it++) {
+        append(&sections[int(Section::EnglishNames)], NamePair{strings.add(it.key().toLower()), strings.add(it.value().toString())});
+    }
+
+    // From cfi2017
+    const QJsonObject categories = readJson(dataDir + "/balance_to_inv_key.json");
+    for (QJsonObject::const_iterator it = categories.constBegin(); it != categories.constEnd(); it++) {
+        append(&sections[int(Section::PartCategories)], NamePair{strings.add(it.key().toLower()), strings.add(it.value().toString())});
+    }
+}
+
+void Compiler::loadInventorySerials(const QString &dataDir)
+{
+    const QJsonObject serialsDb = readJson(dataDir + "/inventory-serials.json");
+    uint32_t assetCount = 0;
+    uint32_t versionCount = 0;
+    for (const QString &categoryName : serialsDb.keys()) {
+        const QJsonObject categoryObject = serialsDb[categoryName].toObject();
+
+        Category category{};
+        category.name = strings.add(categoryName);
+
+        category.firstAsset = assetCount;
+        for (const QJsonValue &val : categoryObject["assets"].toArray()) {
+            append(&sections[int(Section::CategoryAssets)], strings.add(val.toString()));
+            category.assetCount++;
+        }
+        assetCount += category.assetCount;
+
+        category.firstVersion = versionCount;
+        int previousVersion = -1;
+        for (const QJsonValue &val : categoryObject["versions"].toArray()) {
+            const QJsonObject version = val.toObject();
+            if (!version.contains("bits") || !version.contains("version")) {
+                fprintf(stderr, "Invalid version in %s\n", qPrintable(categoryName));
+                continue;
+            }
+            // The editor builds a lookup table per version from these, and relies on the order
+            if (version["version"].toInt() <= previousVersion) {
+                fail("Versions not in order for category " + categoryName);
+            }
+            previousVersion = version["version"].toInt();
+            append(&sections[int(Section::CategoryVersions)], CategoryVersion{uint32_t(version["version"].toInt()), uint32_t(version["bits"].toInt())});
+            category.versionCount++;
+        }
+        versionCount += category.versionCount;
+        if (category.versionCount == 0) {
+            fail("No versions for category " + categoryName);
+        }
+
+        append(&sections[int(Section::Categories)], category);
+    }
+}
+
+StringRef Compiler::addList(const QStringList &list)
+{
+    StringRef ret;
+    ret.offset = uint32_t(sections[int(Section::PartLists)].size() / sizeof(StringRef));
+    ret.length = 0;
+    for (QString entry : list) {
+        entry = entry.trimmed();
+        if (entry.isEmpty()) {
+            continue;
+        }
+        append(&sections[int(Section::PartLists)], strings.add(entry));
+        ret.length++;
+    }
+    return ret;
+}
+
+// Everything from the rarity and out has the same columns in all the files
+void Compiler::addPart(const QString &manufacturer, const QString &itemType, const QStringList &line, const int firstColumn)
+{
+    Part part{};
+    part.manufacturer = strings.add(manufacturer);
+    part.itemType = strings.add(itemType);
+    part.rarity = strings.add(line[firstColumn]);
+    part.balance = strings.add(line[firstColumn + 1]);
+    part.category = strings.add(line[firstColumn + 2]);
+    part.minParts = line[firstColumn + 3].toInt();
+    part.maxParts = line[firstColumn + 4].toInt();
+    part.weight = line[firstColumn + 5].toFloat();
+    part.partId = strings.add(line[firstColumn + 6]);
+
+    const StringRef dependencies = addList(line[firstColumn + 7].split(','));
+    part.firstDependency = dependencies.offset;
+    part.dependencyCount = dependencies.length;
+
+    const StringRef excluders = addList(line[firstColumn + 8].split(','));
+    part.firstExcluder = excluders.offset;
+    part.excluderCount = excluders.length;
+
+    append(&sections[int(Section::Parts)], part);
+}
+
+void Compiler::loadWeaponParts(const QString &dataDir)
+{
+    const QList<QByteArray> lines = readFile(dataDir + "/weapon-parts.tsv").split('\n');
+    for (int i=1; i<lines.count(); i++) { // Skip header
+        if (lines[i].isEmpty()) {
+            continue;
+        }
+        const QStringList line = QString::fromUtf8(lines[i]).split('\t');
+        if (line.length() != 11) {
+            fail("Invalid line in weapon parts file: " + line.join('\t'));
+        }
+        addPart(line[0], line[1], line, 2);
+    }
+}
+
+void Compiler::loadPartsForOther(const QString &dataDir, const QString &type)
+{
+    const QList<QByteArray> lines = readFile(dataDir + "/" + type.toLower() + "-parts.tsv").split('\n');
+    for (int i=1; i<lines.count(); i++) { // Skip header
+        if (lines[i].isEmpty()) {
+            continue;
+        }
+        const QStringList line = QString::fromUtf8(lines[i]).split('\t');
+        if (line.length() != 10) {
+            fail("Invalid line in " + type + " parts file: " + line.join('\t'));
+        }
+        addPart(line[0], type, line, 1);
+    }
+}
+
+void Compiler::addDescription(const QString &id, const QString &positives, const QString &negatives, const QString &effects, const QString &naming)
+{
+    if (descriptionIds.contains(id)) {
+        fprintf(stderr, "Duplicate description for %s\n", qPrintable(id));
+        return;
+    }
+    descriptionIds.insert(id);
+
+    append(&sections[int(Section::Descriptions)], Description{
+        strings.add(id),
+        strings.add(positives),
+        strings.add(negatives),
+        strings.add(effects),
+        strings.add(naming)
+    });
+}
+
+void Compiler::loadWeaponPartDescriptions(const QString &filename)
+{
+    for (const QByteArray &line : readFile(filename).split('\n')) {
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+        const QList<QByteArray> values = line.split('\t');
+        if (values.count() != 5) {
+            fail("Invalid number of values in " + filename);
+        }
+        const QString id = values[0].split('.').last();
+        if (id.isEmpty()) {
+            fprintf(stderr, "Empty id in %s\n", qPrintable(filename));
+            continue;
+        }
+        addDescription(id, values[1], values[2], values[3], values[4]);
+    }
+}
+
+void Compiler::loadShieldPartDescriptions(const QString &dataDir)
+{
+    for (const QByteArray &line : readFile(dataDir + "/descriptions/shields.tsv").split('\n')) {
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+        const QList<QByteArray> values = line.split('\t');
+        if (values.count() != 3) {
+            fail("Invalid number of values in shields desc file");
+        }
+        addDescription(values[0].split('.').last(), {}, {}, values[1], values[2]); // meh, close enough
+    }
+}
+
+void Compiler::loadGrenadePartDescriptions(const QString &dataDir)
+{
+    for (const QByteArray &line : readFile(dataDir + "/descriptions/grenades.tsv").split('\n')) {
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+        const QList<QByteArray> values = line.split('\t');
+        if (values.count() != 3) {
+            fail("Invalid number of values in grenades desc file");
+        }
+        addDescription(values[1].split('.').last(), {}, {}, values[2], values[0]); // meh, close enough
+    }
+}
+
+void Compiler::loadClassModDescriptions(const QString &dataDir, const QString &characterClass)
+{
+    for (const QByteArray &line : readFile(dataDir + "/descriptions/com-" + characterClass + ".tsv").split('\n')) {
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+        QList<QByteArray> values = line.split('\t');
+        if (values.count() > 2) {
+            values.takeFirst(); // meh, can't be bothered to fix the files
+        }
+        if (values.count() < 2) {
+            fail("Invalid number of values in " + characterClass + " com desc file");
+        }
+        addDescription(values[0].split('.').last(), {}, {}, values[1], {});
+    }
+}
+
+void Compiler::loadItemInfos(const QString &dataDir)
+{
+    const QJsonObject rootObject = readJson(dataDir + "/item-data.json");
+
+    for (const QJsonValue &val : rootObject) {
+        const QJsonObject obj = val.toObject();
+        const QString assetName = obj["AssetName"].toString();
+        if (assetName.isEmpty()) {
+            fprintf(stderr, "Invalid item info object\n");
+            continue;
+        }
+
+        ItemInfo info{};
+        info.assetName = strings.add(assetName);
+        info.inventoryName = strings.add(obj["InventoryName"].toString());
+        info.inventoryNameLocationKey = strings.add(obj["InventoryName_LocKey"].toString());
+
+        info.inventoryCategoryHash = obj["InventoryCategoryHash"].toInt();
+
+        info.inventorySize = float(obj["SizeInInventory"].toDouble());
+        info.usesInventoryScore = obj["UsesInventoryScore"].toBool();
+
+        info.monetaryValue = obj["MonetaryValue"].toInt();
+        info.baseMonetaryValueModifier = float(obj["BaseMonetaryValueModifier"].toDouble());
+
+        const QString droppability = obj["Droppability"].toString();
+        if (droppability == QLatin1String("EPD_CanDropAndSell")) {
+            info.canDropOrSell = true;
+        } else if (droppability == QLatin1String("EPD_NoDropOrSell")) {
+            info.canDropOrSell = true;
+        } else {
+            fprintf(stderr, "Unknown droppability %s\n", qPrintable(droppability));
+        }
+
+        append(&sections[int(Section::ItemInfos)], info);
+    }
+}
+
+QByteArray Compiler::build()
+{
+    sections[int(Section::Strings)] = strings.m_data;
+
+    const uint32_t sectionCount = uint32_t(Section::Count);
+    QByteArray ret(sizeof(FileHeader) + sectionCount * sizeof(SectionEntry), '\0');
+
+    QVector<SectionEntry> entries;
+    for (const QByteArray &section : sections) {
+        while (ret.size() % 8) {
+            ret.append('\0');
+        }
+        entries.append(SectionEntry{uint32_t(ret.size()), uint32_t(section.size())});
+        ret.append(section);
+    }
+
+    FileHeader header{};
+    memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = formatVersion;
+    header.sectionCount = sectionCount;
+    header.totalSize = uint32_t(ret.size());
+    memcpy(ret.data(), &header, sizeof(header));
+    memcpy(ret.data() + sizeof(header), entries.constData(), entries.count() * sizeof(SectionEntry));
+
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <data directory> <output file>\n", argv[0]);
+        return 1;
+    }
+    const QString dataDir = QString::fromLocal8Bit(argv[1]);
+
+    Compiler compiler;
+    compiler.loadNames(dataDir);
+    compiler.loadInventorySerials(dataDir);
+
+    compiler.loadWeaponParts(dataDir);
+    compiler.loadPartsForOther(dataDir, "Grenade");
+    compiler.loadPartsForOther(dataDir, "Shield");
+    compiler.loadPartsForOther(dataDir, "ClassMod");
+    compiler.loadPartsForOther(dataDir, "Artifact");
+
+    // Sorted so the first one wins consistently if there are duplicates
+    for (const QFileInfo &file : QDir(dataDir + "/descriptions/weapons/").entryInfoList({"*.tsv"}, QDir::Files, QDir::Name)) {
+        compiler.loadWeaponPartDescriptions(file.filePath());
+    }
+    compiler.loadShieldPartDescriptions(dataDir);
+    compiler.loadGrenadePartDescriptions(dataDir);
+    compiler.loadClassModDescriptions(dataDir, "fl4k");
+    compiler.loadClassModDescriptions(dataDir, "amara");
+    compiler.loadClassModDescriptions(dataDir, "zane");
+
+    compiler.loadItemInfos(dataDir);
+
+    const QByteArray output = compiler.build();
+
+    QSaveFile outFile(QString::fromLocal8Bit(argv[2]));
+    if (!outFile.open(QIODevice::WriteOnly) || outFile.write(output) != output.size() || !outFile.commit()) {
+        fail("Failed to write " + outFile.fileName() + ": " + outFile.errorString());
+    }
+
+    printf("Wrote %s, %d bytes, %d strings, %d parts\n",
+           qPrintable(outFile.fileName()),
+           output.size(),
+           compiler.strings.m_refs.count(),
+           int(compiler.sections[int(Section::Parts)].size() / sizeof(Part)));
+
+    return 0;
+}